@@ -28,25 +28,22 @@ void BTreeNode::save() {
 
 // Get the record and turn it into a block ID.
 BlockID BTreeNode::get_block_id(RecordID record_id) const {
-    Dbt *dbt = this->block->get(record_id);
-    BlockID block_id = *(BlockID *)dbt->get_data();
-    delete dbt;
-    return block_id;
+    RecordView data = this->block->view(record_id);
+    return *(const BlockID *)data.get_data();
 }
 
 // Get the record and turn it into a Handle.
 Handle BTreeNode::get_handle(RecordID record_id) const {
-    Dbt *dbt = this->block->get(record_id);
-    BlockID handle_block_id = *(BlockID *)dbt->get_data();
-    RecordID handle_record_id = *(RecordID *)((char*)dbt->get_data() + sizeof(BlockID));
-    delete dbt;
+    RecordView data = this->block->view(record_id);
+    BlockID handle_block_id = *(const BlockID *)data.get_data();
+    RecordID handle_record_id = *(const RecordID *)(data.get_data() + sizeof(BlockID));
     return Handle(handle_block_id, handle_record_id);
 }
 
 // Get the record and turn it into a KeyValue.
 KeyValue *BTreeNode::get_key(RecordID record_id) const {
-    Dbt *dbt = this->block->get(record_id);
-    char *bytes = (char*)dbt->get_data();
+    RecordView data = this->block->view(record_id);
+    const char *bytes = data.get_data();
     KeyValue *key_value = new KeyValue();
     Value value;
     uint offset = 0;
@@ -71,7 +68,6 @@ KeyValue *BTreeNode::get_key(RecordID record_id) const {
         }
         key_value->push_back(value);
     }
-    delete dbt;
     return key_value;
 }
 
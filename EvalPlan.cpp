@@ -1,5 +1,12 @@
+#include <algorithm>
 #include "EvalPlan.h"
 
+uint EvalPlan::parallelism = 1;  // more only when asked for (set parallelism N)
+
+void EvalPlan::set_parallelism(uint parallelism) {
+    EvalPlan::parallelism = std::max(1U, parallelism);
+}
+
 
 class Dummy : public DbRelation {
 public:
@@ -20,6 +27,40 @@ public:
     virtual ValueDict* project(Handle handle, const ColumnNames* column_names) {return nullptr;}
 };
 
+// Rows of another pipeline that also satisfy a conjunction of equalities.
+// The conjunction's columns are resolved to ordinals up front.
+class SelectIterator : public HandleIterator {
+public:
+    SelectIterator(DbRelation *relation, HandleIterator *rows, const ValueDict *conjunction)
+            : relation(relation), rows(rows), ordinals(relation->get_ordinals(*conjunction)), values() {
+        for (auto const &column: *conjunction)
+            values.push_back(column.second);
+    }
+    virtual ~SelectIterator() {delete rows; delete ordinals;}
+    SelectIterator(const SelectIterator& other) = delete;
+    SelectIterator& operator=(const SelectIterator& other) = delete;
+
+    virtual bool next(Handle &item) {
+        Handle handle;
+        while (rows->next(handle)) {
+            ValueTuple *row = relation->project(handle, ordinals);
+            bool match = *row == values;
+            delete row;
+            if (match) {
+                item = handle;
+                return true;
+            }
+        }
+        return false;
+    }
+
+protected:
+    DbRelation *relation;
+    HandleIterator *rows;
+    ColumnOrdinals *ordinals;
+    ValueTuple values;
+};
+
 EvalPlan::EvalPlan(PlanType type, EvalPlan *relation)
         : type(type), relation(relation), projection(nullptr), select_conjunction(nullptr), table(Dummy::one()) {
 }
@@ -63,37 +104,71 @@ EvalPlan *EvalPlan::optimize() {
     return new EvalPlan(this);  // For now, we don't know how to do anything better
 }
 
-ValueDicts *EvalPlan::evaluate() {
-    ValueDicts *ret = nullptr;
+// Rows come back positionally: in the projection's column order (or the table's, for ProjectAll).
+// A projection of a table scan (with or without a selection in between) is left to the table, which
+// may split the scan across threads; the rows still come back in the order the scan finds them.
+ValueTuples *EvalPlan::evaluate() {
+    ValueTuples *ret = nullptr;
     if (this->type != ProjectAll && this->type != Project)
         throw DbRelationError("Invalid evaluation plan--not ending with a projection");
 
+    EvalPlan *scan = this->relation;
+    ValueDict *where = nullptr;
+    if (scan->type == Select && scan->relation->type == TableScan) {
+        where = scan->select_conjunction;
+        scan = scan->relation;
+    }
+    if (scan->type == TableScan) {
+        DbRelation &table = scan->table;
+        ColumnOrdinals *ordinals;
+        if (this->type == ProjectAll)
+            ordinals = table.get_ordinals(table.get_column_names());
+        else
+            ordinals = table.get_ordinals(*this->projection);
+        try {
+            ret = table.scan_project(where, ordinals, EvalPlan::parallelism);
+        } catch (...) {
+            delete ordinals;
+            throw;
+        }
+        delete ordinals;
+        return ret;
+    }
+
     EvalPipeline pipeline = this->relation->pipeline();
     DbRelation *temp_table = pipeline.first;
-    Handles *handles = pipeline.second;
-    if (this->type == ProjectAll)
-        ret = temp_table->project(handles);
-    else if (this->type == Project)
-        ret = temp_table->project(handles, this->projection);
-    delete handles;
+    HandleIterator *rows = pipeline.second;
+    ColumnOrdinals *ordinals;
+    try {
+        if (this->type == ProjectAll)
+            ordinals = temp_table->get_ordinals(temp_table->get_column_names());
+        else
+            ordinals = temp_table->get_ordinals(*this->projection);
+    } catch (...) {
+        delete rows;
+        throw;
+    }
+    ret = new ValueTuples();
+    Handle handle;
+    while (rows->next(handle))
+        ret->push_back(temp_table->project(handle, ordinals));
+    delete ordinals;
+    delete rows;
     return ret;
 }
 
 EvalPipeline EvalPlan::pipeline() {
     // base cases
     if (this->type == TableScan)
-        return EvalPipeline(&this->table, this->table.select());
+        return EvalPipeline(&this->table, this->table.scan());
     if (this->type == Select && this->relation->type == TableScan)
-        return EvalPipeline(&this->relation->table, this->relation->table.select(this->select_conjunction));
+        return EvalPipeline(&this->relation->table, this->relation->table.scan(this->select_conjunction));
 
     // recursive case
     if (this->type == Select) {
         EvalPipeline pipeline = this->relation->pipeline();
         DbRelation *temp_table = pipeline.first;
-        Handles *handles = pipeline.second;
-        EvalPipeline ret(temp_table, temp_table->select(handles, this->select_conjunction));
-        delete handles;
-        return ret;
+        return EvalPipeline(temp_table, new SelectIterator(temp_table, pipeline.second, this->select_conjunction));
     }
 
     throw DbRelationError("Not implemented: pipeline other than Select or TableScan");
@@ -3,7 +3,8 @@
 #include "storage_engine.h"
 
 
-typedef std::pair<DbRelation*,Handles*> EvalPipeline;
+// the relation and its qualifying rows, handed out as they are found (caller frees the iterator)
+typedef std::pair<DbRelation*,HandleIterator*> EvalPipeline;
 
 class EvalPlan {
 public:
@@ -25,9 +26,13 @@ public:
     EvalPlan *optimize();
 
     // Evaluate the plan: evaluate gets values, pipeline gets handles
-    ValueDicts *evaluate();
+    ValueTuples *evaluate();
     EvalPipeline pipeline();
 
+    // Most threads a table scan may be split across (at least 1; initially 1)
+    static void set_parallelism(uint parallelism);
+    static uint get_parallelism() { return parallelism; }
+
 protected:
 
     PlanType type;
@@ -35,5 +40,7 @@ protected:
     ColumnNames *projection;  // for Project
     ValueDict *select_conjunction;  // for Select
     DbRelation &table;  // for TableScan
+
+    static uint parallelism;
 };
 
@@ -11,6 +11,9 @@ using namespace hsql;
 // define static data
 Tables *SQLExec::tables = nullptr;
 Indices *SQLExec::indices = nullptr;
+uint SQLExec::page_size = DbBlock::BLOCK_SZ;
+string SQLExec::storage = "BDB";
+bool SQLExec::defer_compaction = false;
 
 // make query result be printable
 ostream &operator<<(ostream &out, const QueryResult &qres)
@@ -26,9 +29,8 @@ ostream &operator<<(ostream &out, const QueryResult &qres)
 		out << endl;
 		for (auto const &row : *qres.rows)
 		{
-			for (auto const &column_name : *qres.column_names)
+			for (auto const &value : *row)
 			{
-				Value value = row->at(column_name);
 				switch (value.data_type)
 				{
 				case ColumnAttribute::INT:
@@ -110,6 +112,82 @@ QueryResult *SQLExec::execute(const SQLStatement *statement) throw(SQLExecError)
 	}
 }
 
+void SQLExec::set_page_size(uint page_size)
+{
+	if (!DbBlock::is_valid_size(page_size))
+		throw SQLExecError("page_size must be a power of two from " + to_string(DbBlock::MIN_BLOCK_SZ) +
+						   " to " + to_string(DbBlock::MAX_BLOCK_SZ));
+	SQLExec::page_size = page_size;
+}
+
+void SQLExec::set_storage(string storage)
+{
+	if (storage != "BDB" && storage != "MMAP" && storage != "PAX" && storage != "COLUMN")
+		throw SQLExecError("storage must be BDB, MMAP, PAX, or COLUMN");
+	SQLExec::storage = storage;
+}
+
+void SQLExec::set_option(string name, string value)
+{
+	if (name == "page_size")
+	{
+		uint page_size;
+		try
+		{
+			page_size = (uint)stoul(value);
+		}
+		catch (exception &e)
+		{
+			throw SQLExecError("page_size must be a number");
+		}
+		set_page_size(page_size);
+	}
+	else if (name == "storage")
+		set_storage(value);
+	else if (name == "compaction")
+	{
+		// when slotted pages of new tables squeeze out the space of deleted records
+		if (value != "EAGER" && value != "DEFERRED")
+			throw SQLExecError("compaction must be EAGER or DEFERRED");
+		SQLExec::defer_compaction = value == "DEFERRED";
+	}
+	else if (name == "flush_interval")
+	{
+		// milliseconds between background write-backs of dirty blocks (0 turns the flusher off)
+		uint interval_ms;
+		try
+		{
+			interval_ms = (uint)stoul(value);
+		}
+		catch (exception &e)
+		{
+			throw SQLExecError("flush_interval must be a number");
+		}
+		if (interval_ms == 0)
+			BufferPool::shared().stop_flusher();
+		else
+			BufferPool::shared().start_flusher(interval_ms);
+	}
+	else if (name == "parallelism")
+	{
+		// most threads a table scan may be split across
+		uint parallelism;
+		try
+		{
+			parallelism = (uint)stoul(value);
+		}
+		catch (exception &e)
+		{
+			throw SQLExecError("parallelism must be a number");
+		}
+		if (parallelism == 0)
+			throw SQLExecError("parallelism must be at least 1");
+		EvalPlan::set_parallelism(parallelism);
+	}
+	else
+		throw SQLExecError("unknown option " + name);
+}
+
 void SQLExec::column_definition(const ColumnDefinition *col, Identifier &column_name,
 								ColumnAttribute &column_attribute)
 {
@@ -162,6 +240,8 @@ QueryResult *SQLExec::create_table(const CreateStatement *statement)
 	ValueDict row;
 	// set the table name in the dictionary
 	row["table_name"] = tableName;
+	row["page_size"] = Value((int32_t)SQLExec::page_size);
+	row["storage"] = Value(SQLExec::storage);
 
 	//update _tables schema
 	Handle tHandle = SQLExec::tables->insert(&row);
@@ -197,6 +277,9 @@ QueryResult *SQLExec::create_table(const CreateStatement *statement)
 			}
 			//Actually create the table (relation)
 			DbRelation &table = SQLExec::tables->get_table(tableName);
+			HeapTable *heap_table = dynamic_cast<HeapTable*>(&table);
+			if (heap_table != nullptr)
+				heap_table->set_defer_compaction(SQLExec::defer_compaction);
 			//Check which CREATE type
 			if (statement->ifNotExists)
 				table.create_if_not_exists();
@@ -463,22 +546,26 @@ QueryResult *SQLExec::show_tables()
 	// -3 to discount schema table, schema columns, and schema indices
 	u_long rowNum = handles->size() - 3;
 
-	ValueDicts *rows = new ValueDicts;
+	ValueTuples *rows = new ValueTuples;
+	ColumnOrdinals *ordinals = SQLExec::tables->get_ordinals(*colNames);
 
 	//Use project method to get all entries of table names
 	for (unsigned int i = 0; i < handles->size(); i++)
 	{
-		ValueDict *row = SQLExec::tables->project(handles->at(i), colNames);
-		Identifier tbName = row->at("table_name").s;
+		ValueTuple *row = SQLExec::tables->project(handles->at(i), ordinals);
+		Identifier tbName = row->at(0).s;
 
 		//if table is not the schema table or column schema table, include in results
 		if (tbName != Tables::TABLE_NAME && tbName != Columns::TABLE_NAME && tbName != Indices::TABLE_NAME)
 			rows->push_back(row);
+		else
+			delete row;
 	}
 
 	//Handle memory because select method returns the "new" pointer
 	//declared in heap
 	delete handles;
+	delete ordinals;
 
 	return new QueryResult(colNames, colAttrs, rows,
 						   "successfully returned " + to_string(rowNum) + " rows"); // FIXME
@@ -504,7 +591,8 @@ QueryResult *SQLExec::show_columns(const ShowStatement *statement)
 	Handles *handles = cols.select(&where);
 	u_long rowNum = handles->size();
 
-	ValueDicts *rows = new ValueDicts;
+	ValueTuples *rows = new ValueTuples;
+	ColumnOrdinals *ordinals = cols.get_ordinals(*colNames);
 
 	//Use project method to get all entries of column names of the table
 	// iterate through the handles of the specific table targeted
@@ -512,7 +600,7 @@ QueryResult *SQLExec::show_columns(const ShowStatement *statement)
 	{
 		// get each column name and teh data type from the table.
 		// an example would be to return "x (int)" "y(int)" "z(int)" on goober.
-		ValueDict *row = cols.project(handles->at(i), colNames);
+		ValueTuple *row = cols.project(handles->at(i), ordinals);
 		// add each row to the rows vector
 		rows->push_back(row);
 	}
@@ -520,6 +608,7 @@ QueryResult *SQLExec::show_columns(const ShowStatement *statement)
 	//Handle memory because select method returns the "new" pointer
 	//declared in heap
 	delete handles;
+	delete ordinals;
 
 	//return the QR of all the information about the columns. This
 	// will get ouptutted to the terminal for the user to see the progress
@@ -566,17 +655,19 @@ QueryResult *SQLExec::show_index(const ShowStatement *statement)
 	// the row numbers need to be equal to the number of handles we have
 	u_long rowNum = handles->size();
 
-	ValueDicts *rows = new ValueDicts;
+	ValueTuples *rows = new ValueTuples;
+	ColumnOrdinals *ordinals = SQLExec::indices->get_ordinals(*column_names);
 	//Use project method to get all entries of column names of the table
 	for (unsigned int i = 0; i < handles->size(); i++)
 	{
-		ValueDict *row = SQLExec::indices->project(handles->at(i), column_names);
+		ValueTuple *row = SQLExec::indices->project(handles->at(i), ordinals);
 		rows->push_back(row);
 	}
 
 	//Handle memory because select method returns the "new" pointer
 	//declared in heap
 	delete handles;
+	delete ordinals;
 
 	//the Query result will return the name of the index's information
 	// along wtih the 2 rows we constructed (x and y)
@@ -675,7 +766,7 @@ QueryResult *SQLExec::del(const DeleteStatement *statement)
 
 	EvalPlan *ep = plan->optimize();
 	EvalPipeline pipeline = ep->pipeline();
-	Handles *handles = pipeline.second;
+	HandleIterator *rows = pipeline.second;
 
 	// remove from indices
 	auto index_names = SQLExec::indices->get_index_names(table_name);
@@ -683,7 +774,8 @@ QueryResult *SQLExec::del(const DeleteStatement *statement)
 	u_long n = 0;
 	u_long m = index_names.size();
 
-	for (auto const &handle : *handles)
+	Handle handle;
+	while (rows->next(handle))
 	{
 		n++;
 		for (auto const index_name : index_names)
@@ -694,6 +786,7 @@ QueryResult *SQLExec::del(const DeleteStatement *statement)
 		// remove from table
 		tb.del(handle);
 	}
+	delete rows;
 
 	return new QueryResult("successfully deleted " + to_string(n) + " rows from " + table_name + " and " + to_string(m) + " indices");
 }
@@ -737,7 +830,7 @@ QueryResult *SQLExec::select(const SelectStatement *statement)
 	}
 
 	EvalPlan *optimized = plan->optimize();
-	ValueDicts *rows = optimized->evaluate();
+	ValueTuples *rows = optimized->evaluate();
 
 	column_attributes = table.get_column_attributes(*column_names);
 
@@ -21,6 +21,7 @@ class SQLExecError : public std::runtime_error
 
 /**
  * @class QueryResult - data structure to hold all the returned data for a query execution
+ * Each row holds its values positionally, in the order of column_names.
  */
 class QueryResult
 {
@@ -30,21 +31,21 @@ class QueryResult
     QueryResult(std::string message) : column_names(nullptr), column_attributes(nullptr), rows(nullptr),
                                        message(message) {}
 
-    QueryResult(ColumnNames *column_names, ColumnAttributes *column_attributes, ValueDicts *rows, std::string message)
+    QueryResult(ColumnNames *column_names, ColumnAttributes *column_attributes, ValueTuples *rows, std::string message)
         : column_names(column_names), column_attributes(column_attributes), rows(rows), message(message) {}
 
     virtual ~QueryResult();
 
     ColumnNames *get_column_names() const { return column_names; }
     ColumnAttributes *get_column_attributes() const { return column_attributes; }
-    ValueDicts *get_rows() const { return rows; }
+    ValueTuples *get_rows() const { return rows; }
     const std::string &get_message() const { return message; }
     friend std::ostream &operator<<(std::ostream &stream, const QueryResult &qres);
 
   protected:
     ColumnNames *column_names;
     ColumnAttributes *column_attributes;
-    ValueDicts *rows;
+    ValueTuples *rows;
     std::string message;
 };
 
@@ -61,11 +62,47 @@ class SQLExec
 	 */
     static QueryResult *execute(const hsql::SQLStatement *statement) throw(SQLExecError);
 
+    /**
+	 * Set the page size used by subsequent CREATE TABLE statements.
+	 * @param page_size   bytes per block, a power of two from 4096 to 65536
+	 * @throws            SQLExecError if page_size isn't allowed
+	 */
+    static void set_page_size(uint page_size);
+    static uint get_page_size() { return page_size; }
+
+    /**
+	 * Set the storage backend used by subsequent CREATE TABLE statements.
+	 * @param storage     "BDB" (Berkeley DB RecNo files), "MMAP" (memory-mapped files), "PAX"
+	 *                    (Berkeley DB RecNo files of PaxPage blocks), or "COLUMN" (a ColumnTable:
+	 *                    Berkeley DB files, one per column)
+	 * @throws            SQLExecError if storage isn't one of those
+	 */
+    static void set_storage(std::string storage);
+    static std::string get_storage() { return storage; }
+
+    /**
+	 * Set a session option by name (page_size, storage, compaction, flush_interval, or parallelism), as typed at
+	 * the prompt.
+	 * @param name        option name
+	 * @param value       option value
+	 * @throws            SQLExecError if the option or value isn't allowed
+	 */
+    static void set_option(std::string name, std::string value);
+
   protected:
     // the one place in the system that holds the _tables table and _indices table
     static Tables *tables;
     static Indices *indices;
 
+    // session option: block size for newly created tables
+    static uint page_size;
+
+    // session option: storage backend for newly created tables
+    static std::string storage;
+
+    // session option: whether newly created tables' slotted pages defer compaction
+    static bool defer_compaction;
+
     // recursive decent into the AST
     static QueryResult *create(const hsql::CreateStatement *statement);
     static QueryResult *create_table(const hsql::CreateStatement *statement);
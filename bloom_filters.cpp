@@ -0,0 +1,345 @@
+/**
+ * @file bloom_filters.cpp - implementation of:
+ * BloomFilters
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <cmath>
+#include <memory.h>
+#include <iostream>
+#include "bloom_filters.h"
+using namespace std;
+
+const double BloomFilters::DEFAULT_FP_RATE = 0.01;
+
+/**
+ * @class BloomFilter - the blocks of a BloomFilters that may have rows with given TEXT values.
+ */
+class BloomFilter : public BlockFilter {
+public:
+	BloomFilter(const BloomFilters &filters, const vector<uint> &slots, const vector<uint64_t> &hashes)
+			: filters(filters), slots(slots), hashes(hashes) {}
+	virtual ~BloomFilter() {}
+
+	virtual bool wanted(BlockID block_id) const {
+		for (uint i = 0; i < this->slots.size(); i++)
+			if (!this->filters.may_contain_hash(block_id, this->slots[i], this->hashes[i]))
+				return false;
+		return true;
+	}
+
+protected:
+	const BloomFilters &filters;
+	vector<uint> slots;       // which of the filtered columns
+	vector<uint64_t> hashes;  // of the value wanted in each
+};
+
+BloomFilters::BloomFilters(string name, const ColumnAttributes &column_attributes) : dbfilename(name + ".bloom.db"),
+		closed(true), db(_DB_ENV, 0), data_types(), columns(), slot_of(), fp_rate(0.0), rows_per_block(0), words(0),
+		hashes(0), blocks(0), bits(), dirty(), behind(false), marked_behind(false) {
+	for (auto attribute: column_attributes)
+		this->data_types.push_back(attribute.get_data_type());
+}
+
+// Size the filters for rows_per_block values each and make the file, with no blocks yet.
+void BloomFilters::create(const ColumnOrdinals &columns, double fp_rate, uint rows_per_block) {
+	if (!(fp_rate > 0.0 && fp_rate < 1.0))
+		throw DbRelationError("Bloom filter false-positive rate must be between 0 and 1");
+	if (columns.empty())
+		throw DbRelationError("no columns to make Bloom filters on");
+	for (auto column: columns)
+		if (column >= this->data_types.size() || this->data_types[column] != ColumnAttribute::TEXT)
+			throw DbRelationError("Bloom filters are only made on TEXT columns");
+	if (!this->closed || exists())
+		drop();
+	set_columns(columns);
+	this->fp_rate = fp_rate;
+	this->rows_per_block = rows_per_block > 0 ? rows_per_block : 1;
+	double n = this->rows_per_block;
+	double m = ceil(-n * log(fp_rate) / (log(2.0) * log(2.0)));
+	uint most_words = DbBlock::BLOCK_SZ / sizeof(uint64_t);  // a filter has to fit on a page
+	this->words = m >= most_words * 64.0 ? most_words : max(1U, (uint)((m + 63) / 64));
+	double k = round(this->words * 64 / n * log(2.0));
+	this->hashes = k < 1.0 ? 1 : k > 16.0 ? 16 : (uint)k;
+	this->blocks = 0;
+	this->bits.clear();
+	this->dirty.clear();
+	db_open(DB_CREATE|DB_EXCL);
+	this->behind = false;
+	write_header(true);
+	this->marked_behind = false;
+}
+
+// Delete the file.
+void BloomFilters::drop(void) {
+	this->bits.clear();
+	this->dirty.clear();
+	this->marked_behind = false;
+	close();
+	Db db(_DB_ENV, 0);
+	db.remove(this->dbfilename.c_str(), nullptr, 0);
+}
+
+// Open the file, check it against the table's columns and read in the filters.
+void BloomFilters::open(void) {
+	if (!this->closed)
+		return;
+	db_open();
+	char buffer[DbBlock::BLOCK_SZ];
+	read_page(HEADER, buffer);
+	uint32_t *header = (uint32_t*)buffer;
+	if (header[0] != MAGIC || header[1] != VERSION || header[8] > this->data_types.size())
+		throw DbRelationError(this->dbfilename + " is not a set of Bloom filters for this table");
+	bool up_to_date = header[2] != 0;
+	this->blocks = header[3];
+	this->fp_rate = header[4] / 1e6;
+	this->rows_per_block = header[5];
+	this->words = header[6];
+	this->hashes = header[7];
+	ColumnOrdinals columns(header + 9, header + 9 + header[8]);
+	for (auto column: columns)
+		if (column >= this->data_types.size() || this->data_types[column] != ColumnAttribute::TEXT)
+			throw DbRelationError(this->dbfilename + " does not match its table's columns");
+	if (this->words == 0 || this->words > DbBlock::BLOCK_SZ / sizeof(uint64_t) || this->hashes == 0)
+		throw DbRelationError(this->dbfilename + " has a bad header");
+	set_columns(columns);
+
+	uint n_filters = this->blocks * (uint)this->columns.size();
+	uint per_page = filters_per_page();
+	uint n_pages = (n_filters + per_page - 1) / per_page;
+	this->bits.assign((size_t)n_filters * this->words, 0);
+	this->dirty.assign(n_pages, false);
+	const size_t filter_bytes = this->words * sizeof(uint64_t);
+	for (uint page = 0; page < n_pages; page++) {
+		read_page(FIRST_FILTER_PAGE + page, buffer);
+		uint first = page * per_page;
+		uint n = min(per_page, n_filters - first);
+		memcpy(this->bits.data() + (size_t)first * this->words, buffer, n * filter_bytes);
+	}
+	this->behind = !up_to_date;
+	this->marked_behind = !up_to_date;
+}
+
+// Write out any changes and close the file.
+void BloomFilters::close(void) {
+	if (this->closed)
+		return;
+	flush();
+	this->db.close(0);
+	this->closed = true;
+	this->bits.clear();
+	this->dirty.clear();
+	this->columns.clear();
+	this->slot_of.clear();
+}
+
+void BloomFilters::clear(void) {
+	if (this->closed)
+		return;
+	if (!this->marked_behind) {
+		write_header(false);
+		this->marked_behind = true;
+	}
+	fill(this->bits.begin(), this->bits.end(), 0);
+	fill(this->dirty.begin(), this->dirty.end(), true);
+}
+
+// Write the changed pages, then mark the header up to date.
+void BloomFilters::flush(void) {
+	if (this->closed)
+		return;
+	char buffer[DbBlock::BLOCK_SZ];
+	uint n_filters = this->blocks * (uint)this->columns.size();
+	uint per_page = filters_per_page();
+	const size_t filter_bytes = this->words * sizeof(uint64_t);
+	for (uint page = 0; page < this->dirty.size(); page++) {
+		if (!this->dirty[page])
+			continue;
+		memset(buffer, 0, sizeof(buffer));
+		uint first = page * per_page;
+		uint n = min(per_page, n_filters - first);
+		memcpy(buffer, this->bits.data() + (size_t)first * this->words, n * filter_bytes);
+		write_page(FIRST_FILTER_PAGE + page, buffer);
+		this->dirty[page] = false;
+	}
+	if (this->marked_behind) {
+		write_header(true);
+		this->marked_behind = false;
+	}
+}
+
+void BloomFilters::sync(void) {
+	if (this->closed)
+		return;
+	flush();
+	this->db.sync(0);
+}
+
+// Set each of the value's hashes' bits in the block's filter for each filtered column, growing the
+// filters to the block if need be. The first change since the last flush marks the header as behind.
+void BloomFilters::add(BlockID block_id, const ValueTuple &row) {
+	if (this->closed || this->columns.empty() || block_id == 0)
+		return;
+	if (!this->marked_behind) {
+		write_header(false);
+		this->marked_behind = true;
+	}
+	uint n = (uint)this->columns.size();
+	uint per_page = filters_per_page();
+	if (block_id > this->blocks) {
+		this->blocks = block_id;
+		this->bits.resize((size_t)this->blocks * n * this->words, 0);
+		this->dirty.resize((this->blocks * n + per_page - 1) / per_page, true);
+	}
+	const uint64_t m = this->words * 64;
+	for (uint slot = 0; slot < n; slot++) {
+		uint column = this->columns[slot];
+		uint64_t h = hash(column < row.size() ? row[column].s : "");  // a short row has the default
+		uint filter = (block_id - 1) * n + slot;
+		uint64_t *words = this->bits.data() + (size_t)filter * this->words;
+		uint64_t step = (h >> 32) | 1;
+		for (uint i = 0; i < this->hashes; i++, h += step) {
+			uint64_t bit = h % m;
+			words[bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+		this->dirty[filter / per_page] = true;
+	}
+}
+
+bool BloomFilters::may_contain(BlockID block_id, uint column, const string &value) const {
+	if (this->closed || column >= this->slot_of.size() || this->slot_of[column] < 0)
+		return true;
+	return may_contain_hash(block_id, (uint)this->slot_of[column], hash(value));
+}
+
+// Check the value's bits in the block's filter for the slot-th filtered column.
+bool BloomFilters::may_contain_hash(BlockID block_id, uint slot, uint64_t h) const {
+	if (block_id == 0 || block_id > this->blocks)
+		return true;
+	const uint64_t m = this->words * 64;
+	uint filter = (block_id - 1) * (uint)this->columns.size() + slot;
+	const uint64_t *words = this->bits.data() + (size_t)filter * this->words;
+	uint64_t step = (h >> 32) | 1;
+	for (uint i = 0; i < this->hashes; i++, h += step) {
+		uint64_t bit = h % m;
+		if (!((words[bit / 64] >> (bit % 64)) & 1))
+			return false;
+	}
+	return true;
+}
+
+BlockFilter* BloomFilters::filter(const ColumnOrdinals &ordinals, const ValueTuple &values) const {
+	if (this->closed)
+		return nullptr;
+	vector<uint> slots;
+	vector<uint64_t> hashes;
+	for (uint i = 0; i < ordinals.size(); i++) {
+		uint column = ordinals[i];
+		if (column < this->slot_of.size() && this->slot_of[column] >= 0
+			&& values[i].data_type == ColumnAttribute::TEXT) {
+			slots.push_back((uint)this->slot_of[column]);
+			hashes.push_back(hash(values[i].s));
+		}
+	}
+	if (slots.empty())
+		return nullptr;
+	return new BloomFilter(*this, slots, hashes);
+}
+
+// Wrapper for Berkeley DB open, which does both open and creation.
+void BloomFilters::db_open(uint flags) {
+	if (!this->closed)
+		return;
+	this->db.set_re_len(DbBlock::BLOCK_SZ);
+	this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
+	this->closed = false;
+}
+
+void BloomFilters::write_header(bool up_to_date) {
+	char buffer[DbBlock::BLOCK_SZ];
+	memset(buffer, 0, sizeof(buffer));
+	uint32_t *header = (uint32_t*)buffer;
+	header[0] = MAGIC;
+	header[1] = VERSION;
+	header[2] = up_to_date ? 1 : 0;
+	header[3] = this->blocks;
+	header[4] = max(1U, (uint32_t)round(this->fp_rate * 1e6));
+	header[5] = this->rows_per_block;
+	header[6] = this->words;
+	header[7] = this->hashes;
+	header[8] = (uint32_t)this->columns.size();
+	for (uint i = 0; i < this->columns.size(); i++)
+		header[9 + i] = this->columns[i];
+	write_page(HEADER, buffer);
+}
+
+void BloomFilters::read_page(BlockID page, char *buffer) {
+	Dbt key(&page, sizeof(page));
+	Dbt data;
+	data.set_data(buffer);
+	data.set_ulen(DbBlock::BLOCK_SZ);
+	data.set_flags(DB_DBT_USERMEM);
+	if (this->db.get(nullptr, &key, &data, 0) != 0)
+		throw DbRelationError("Bloom filter page " + to_string(page) + " missing from " + this->dbfilename);
+}
+
+void BloomFilters::write_page(BlockID page, const char *buffer) {
+	Dbt key(&page, sizeof(page));
+	Dbt data((void*)buffer, DbBlock::BLOCK_SZ);
+	this->db.put(nullptr, &key, &data, 0);
+}
+
+void BloomFilters::set_columns(const ColumnOrdinals &columns) {
+	this->columns = columns;
+	this->slot_of.assign(this->data_types.size(), -1);
+	for (uint slot = 0; slot < columns.size(); slot++)
+		this->slot_of[columns[slot]] = (int)slot;
+}
+
+// 64-bit FNV-1a, then a finalizer to spread the bits (the filters are kept on disk, so the hash
+// must not change from run to run, as std::hash may).
+uint64_t BloomFilters::hash(const string &value) {
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (unsigned char c: value) {
+		h ^= c;
+		h *= 0x100000001B3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB3F99FE1A85BULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// test function -- returns true if all tests pass
+bool test_bloom_filters() {
+	cout << "test_bloom_filters: " << endl;
+	ColumnAttributes column_attributes({ColumnAttribute(ColumnAttribute::INT), ColumnAttribute(ColumnAttribute::TEXT),
+										ColumnAttribute(ColumnAttribute::BOOLEAN)});
+
+	// filters left marked as behind (as after a crash) are found to be on the next open
+	BloomFilters filters("_test_bloom_cpp", column_attributes), reader("_test_bloom_cpp", column_attributes);
+	filters.create(ColumnOrdinals({1}), 0.1, 100);
+	uint loose_bits = filters.get_bits();
+	ValueTuple x_row({Value(1), Value("x"), Value(1)});
+	filters.add(3, x_row);
+	reader.open();
+	bool ok = reader.is_behind();
+	reader.close();
+
+	// a lower false-positive rate takes more bits and hashes, and a flush leaves them up to date
+	filters.create(ColumnOrdinals({1}), 0.001, 100);
+	ok = ok && filters.get_bits() > loose_bits && filters.get_hashes() > 1;
+	filters.add(3, x_row);
+	filters.flush();
+	reader.open();
+	ok = ok && !reader.is_behind() && reader.may_contain(3, 1, "x") && !reader.may_contain(2, 1, "x")
+		 && reader.may_contain(4, 1, "y") && reader.may_contain(3, 0, "y");
+	reader.close();
+	filters.drop();
+	if (!ok)
+		return false;
+	cout << "bloom filters ok" << endl;
+	return true;
+}
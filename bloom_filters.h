@@ -0,0 +1,157 @@
+/**
+ * @file bloom_filters.h - per-block Bloom filters on TEXT columns, kept next to a HeapTable's file.
+ * BloomFilters
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include "db_cxx.h"
+#include "storage_engine.h"
+#include "zone_map.h"
+
+/**
+ * @class BloomFilters - for each block of a table, a Bloom filter of the values in each of some TEXT columns.
+ *
+ * A block whose filter for a column doesn't have a value has no row with that value, so a scan for
+ * it can pass the block over. The filters only ever gain values: deleted rows' values stay in them,
+ * which costs false positives but never a missed row. The filters are sized when they are created,
+ * from the false-positive rate wanted and the number of rows a block is expected to hold
+ * (m = -n ln p / (ln 2)^2 bits and k = (m / n) ln 2 hashes for n rows and rate p); blocks with more
+ * rows than that get more false positives.
+ *
+ * Stored in their own Berkeley DB RecNo file (<name>.bloom.db):
+ *      Block 1: header
+ *          Bytes 0x00 - 0x03: magic number
+ *          Bytes 0x04 - 0x07: format version
+ *          Bytes 0x08 - 0x0B: 1 if the filters are up to date with the table, 0 if they may be behind it
+ *          Bytes 0x0C - 0x0F: number of blocks with filters
+ *          Bytes 0x10 - 0x13: false-positive rate, in millionths
+ *          Bytes 0x14 - 0x17: rows per block the filters are sized for
+ *          Bytes 0x18 - 0x1B: 64-bit words per filter
+ *          Bytes 0x1C - 0x1F: hashes per value
+ *          Bytes 0x20 - 0x23: number of columns filtered, c
+ *          then c 4-byte column ordinals
+ *      Block 2...: the filters, as many whole ones to a page as fit: block b's filter for the
+ *          i-th column is number (b - 1) * c + i
+ * The filters are read in on open() and kept in memory; changed pages are written on flush() and
+ * close(). The header is marked as behind before the first change after opening or flushing
+ * (and before the change reaches the table), and as up to date again once the changed pages
+ * are written; filters found to be behind on open() have to be rebuilt from the table.
+ */
+class BloomFilters {
+public:
+	static const double DEFAULT_FP_RATE;
+
+	/**
+	 * @param name               the table's file name (without extension)
+	 * @param column_attributes  the table's columns
+	 */
+	BloomFilters(std::string name, const ColumnAttributes &column_attributes);
+	virtual ~BloomFilters() {}
+	BloomFilters(const BloomFilters& other) = delete;
+	BloomFilters(BloomFilters&& temp) = delete;
+	BloomFilters& operator=(const BloomFilters& other) = delete;
+	BloomFilters& operator=(BloomFilters&& temp) = delete;
+
+	/**
+	 * Create the filters, empty, replacing any there were.
+	 * @param columns         TEXT columns to filter on
+	 * @param fp_rate         chance a block is read for a value it doesn't have (between 0 and 1)
+	 * @param rows_per_block  rows a block is expected to hold
+	 * @throws                DbRelationError for a column that isn't TEXT or a rate out of range
+	 */
+	virtual void create(const ColumnOrdinals &columns, double fp_rate, uint rows_per_block);
+	virtual void drop(void);
+
+	/**
+	 * Open the filters and read them in.
+	 * @throws  DbRelationError if the file isn't filters for this table
+	 */
+	virtual void open(void);
+	virtual void close(void);
+	virtual bool exists(void) const {return db_file_exists(this->dbfilename);}
+	bool is_open(void) const {return !this->closed;}
+
+	/**
+	 * Check if the filters were found to be behind the table when opened (see clear()).
+	 */
+	bool is_behind(void) const {return this->behind;}
+
+	/**
+	 * Empty all the filters, to rebuild them from the table's rows.
+	 */
+	virtual void clear(void);
+
+	/**
+	 * Write out the changed filters.
+	 */
+	virtual void flush(void);
+
+	/**
+	 * Flush and force the file to disk.
+	 */
+	virtual void sync(void);
+
+	/**
+	 * Add a row's values to a block's filters (a no-op if closed). Call before the row goes into the block.
+	 * @param row  one value per column, in column order
+	 */
+	virtual void add(BlockID block_id, const ValueTuple &row);
+
+	/**
+	 * Check if a block may have a row with the given value in a column.
+	 * @param column  ordinal of the column in the table (true for one that isn't filtered)
+	 */
+	virtual bool may_contain(BlockID block_id, uint column, const std::string &value) const;
+
+	/**
+	 * A filter wanting just the blocks that may have rows with all the given values. Only the
+	 * TEXT values for filtered columns play a part.
+	 * @returns  the filter (freed by caller; uses these filters, so must not outlive them), or nullptr
+	 *           if none of the values can rule out a block
+	 */
+	virtual BlockFilter* filter(const ColumnOrdinals &ordinals, const ValueTuple &values) const;
+
+	const ColumnOrdinals& get_columns() const {return columns;}
+	double get_fp_rate() const {return fp_rate;}
+	uint get_bits() const {return words * 64;}
+	uint get_hashes() const {return hashes;}
+
+protected:
+	friend class BloomFilter;
+
+	static const uint32_t MAGIC = 0x424C4D31;  // "BLM1"
+	static const uint32_t VERSION = 1;
+	static const BlockID HEADER = 1;
+	static const BlockID FIRST_FILTER_PAGE = HEADER + 1;
+
+	std::string dbfilename;
+	bool closed;
+	Db db;
+	std::vector<ColumnAttribute::DataType> data_types;  // of each column in the table
+	ColumnOrdinals columns;      // filtered columns
+	std::vector<int> slot_of;    // for each column in the table, its place among the filtered ones or -1
+	double fp_rate;
+	uint rows_per_block;
+	uint words;                  // per filter
+	uint hashes;                 // per value
+	BlockID blocks;              // blocks with filters
+	std::vector<uint64_t> bits;  // filter f at words [f * words, (f + 1) * words)
+	std::vector<bool> dirty;     // filter pages needing a write
+	bool behind;                 // the filters were behind the table when opened
+	bool marked_behind;          // the header on disk says the filters may be behind
+
+	virtual void db_open(uint flags=0);
+	virtual void write_header(bool up_to_date);
+	virtual void read_page(BlockID page, char *buffer);
+	virtual void write_page(BlockID page, const char *buffer);
+	bool may_contain_hash(BlockID block_id, uint slot, uint64_t h) const;
+	void set_columns(const ColumnOrdinals &columns);
+	uint filters_per_page() const {return DbBlock::BLOCK_SZ / (this->words * sizeof(uint64_t));}
+	static uint64_t hash(const std::string &value);
+};
+
+bool test_bloom_filters();
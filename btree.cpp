@@ -1,11 +1,11 @@
 #include "btree.h"
 
-BTreeIndex::BTreeIndex(DbRelation &relation, Identifier name, ColumnNames key_columns, bool unique)
+BTreeIndex::BTreeIndex(DbRelation &relation, Identifier name, ColumnNames key_columns, bool unique, uint page_size)
 	: DbIndex(relation, name, key_columns, unique),
 	  closed(true),
 	  stat(nullptr),
 	  root(nullptr),
-	  file(relation.get_table_name() + "-" + name),
+	  file(relation.get_table_name() + "-" + name, page_size),  // bigger pages make for a shallower tree
 	  key_profile()
 {
 	if (!unique)
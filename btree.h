@@ -4,7 +4,8 @@
 
 class BTreeIndex : public DbIndex {
 public:
-    BTreeIndex(DbRelation& relation, Identifier name, ColumnNames key_columns, bool unique);
+    BTreeIndex(DbRelation& relation, Identifier name, ColumnNames key_columns, bool unique,
+               uint page_size=DbBlock::BLOCK_SZ);
     virtual ~BTreeIndex();
 
     virtual void create();
@@ -0,0 +1,340 @@
+/**
+ * @file buffer_pool.cpp - implementation of:
+ * BufferPool
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <memory.h>
+#include <chrono>
+#include <ostream>
+#include "buffer_pool.h"
+#include "heap_storage.h"
+using namespace std;
+
+BufferPool& BufferPool::shared() {
+	static BufferPool pool;
+	return pool;
+}
+
+BufferPool::BufferPool(uint n_frames) : frames(n_frames), page_table(), clock_hand(0), in_flight(0), file_io(),
+										hits(0), misses(0), writes(0), latch(), io_done(), flusher(), wake_flusher(),
+										stopping(false) {
+	if (n_frames == 0)
+		throw BufferPoolError("buffer pool needs at least one frame");
+	for (auto &frame: this->frames) {
+		frame.data = new char[DbBlock::BLOCK_SZ];
+		frame.size = DbBlock::BLOCK_SZ;
+		frame.pool = this;
+	}
+}
+
+// Frames are not written back here--files must be flushed or closed before the pool goes away.
+BufferPool::~BufferPool() {
+	stop_flusher();
+	for (auto &frame: this->frames)
+		delete[] frame.data;
+}
+
+BufferPool::PageKey BufferPool::key(const HeapFile* file, BlockID block_id) {
+	return PageKey(file->dbfilename, block_id);
+}
+
+// Find the block in the pool, or read it into a victim frame. Either way, pin it.
+// A block on its way in (or a victim on its way out) is waited for and looked up again.
+BufferFrame* BufferPool::pin(HeapFile* file, BlockID block_id, bool is_new) {
+	unique_lock<mutex> guard(this->latch);
+	PageKey wanted = key(file, block_id);
+	for (;;) {
+		auto it = this->page_table.find(wanted);
+		if (it != this->page_table.end()) {
+			BufferFrame &frame = this->frames[it->second];
+			if (frame.in_flight) {
+				this->io_done.wait(guard);
+				continue;
+			}
+			if (is_new)
+				memset(frame.data, 0, file->get_block_size());
+			frame.pin_count++;
+			frame.referenced = true;
+			this->hits++;
+			return &frame;
+		}
+		uint i = victim();
+		if (i == NO_FRAME) {
+			if (this->in_flight == 0)
+				throw BufferPoolError("all buffer frames are pinned");
+			this->io_done.wait(guard);
+			continue;
+		}
+		this->misses++;
+		BufferFrame &frame = load(guard, i, file, block_id, nullptr, is_new);
+		frame.pin_count = 1;
+		frame.referenced = true;
+		return &frame;
+	}
+}
+
+bool BufferPool::preload(HeapFile* file, BlockID block_id, const void* image) {
+	unique_lock<mutex> guard(this->latch);
+	if (this->page_table.find(key(file, block_id)) != this->page_table.end())
+		return false;
+	uint i = victim();
+	if (i == NO_FRAME)
+		return false;  // everything is pinned; the block will just be read when it is wanted
+	BufferFrame &frame = load(guard, i, file, block_id, image, false);
+	frame.pin_count = 0;
+	frame.referenced = false;
+	return true;
+}
+
+bool BufferPool::contains(HeapFile* file, BlockID block_id) {
+	lock_guard<mutex> guard(this->latch);
+	return this->page_table.find(key(file, block_id)) != this->page_table.end();
+}
+
+void BufferPool::unpin(BufferFrame* frame) {
+	lock_guard<mutex> guard(this->latch);
+	if (frame->pin_count > 0)
+		frame->pin_count--;
+}
+
+bool BufferPool::mark_dirty(HeapFile* file, BlockID block_id) {
+	lock_guard<mutex> guard(this->latch);
+	auto it = this->page_table.find(key(file, block_id));
+	if (it == this->page_table.end())
+		return false;
+	this->frames[it->second].dirty = true;
+	return true;
+}
+
+void BufferPool::flush(HeapFile* file) {
+	unique_lock<mutex> guard(this->latch);
+	write_dirty(guard, file, false);
+}
+
+void BufferPool::flush_all() {
+	unique_lock<mutex> guard(this->latch);
+	write_dirty(guard, nullptr, false);
+}
+
+void BufferPool::start_flusher(uint interval_ms) {
+	stop_flusher();
+	this->stopping = false;
+	this->flusher = thread(&BufferPool::run_flusher, this, interval_ms);
+}
+
+void BufferPool::stop_flusher() {
+	if (!this->flusher.joinable())
+		return;
+	{
+		lock_guard<mutex> guard(this->latch);
+		this->stopping = true;
+	}
+	this->wake_flusher.notify_all();
+	this->flusher.join();
+}
+
+void BufferPool::discard(HeapFile* file, bool write_back) {
+	unique_lock<mutex> guard(this->latch);
+	if (write_back)
+		write_dirty(guard, file, false);
+	wait_for_io(guard, file);  // so nobody is still bringing in one of its blocks
+	const string &name = file->dbfilename;
+	auto it = this->page_table.lower_bound(key(file, 0));
+	while (it != this->page_table.end() && it->first.first == name) {
+		BufferFrame &frame = this->frames[it->second];
+		frame.file = nullptr;
+		frame.block_id = 0;
+		frame.dirty = false;
+		frame.referenced = false;
+		it = this->page_table.erase(it);
+	}
+}
+
+double BufferPool::hit_rate() const {
+	unsigned long total = this->hits + this->misses;
+	return total == 0 ? 0.0 : (double)this->hits / total;
+}
+
+// CLOCK: sweep the frames, giving referenced ones a second chance, until an unpinned one turns up.
+// Returns NO_FRAME if there isn't one (every frame is pinned or in flight). Caller holds the latch.
+uint BufferPool::victim() {
+	uint n = (uint)this->frames.size();
+	for (uint sweep = 0; sweep < 2 * n; sweep++) {
+		uint i = this->clock_hand;
+		this->clock_hand = (this->clock_hand + 1) % n;
+		BufferFrame &frame = this->frames[i];
+		if (frame.pin_count > 0 || frame.in_flight)
+			continue;
+		if (frame.file == nullptr || !frame.referenced)
+			return i;
+		frame.referenced = false;
+	}
+	return NO_FRAME;
+}
+
+// Put a block into victim frame i: the block is entered in the page table and the frame marked in
+// flight under the latch, then the latch is let go while the victim's old block is written back
+// (if dirty) and the new one is copied from image, zero-filled, or read from the file. The old
+// block stays in the page table until then, so whoever wants it waits rather than reading a stale
+// copy. Caller holds the latch (again, on return) and sets pin_count and referenced.
+BufferFrame& BufferPool::load(unique_lock<mutex>& guard, uint i, HeapFile* file, BlockID block_id,
+							  const void* image, bool is_new) {
+	BufferFrame &frame = this->frames[i];
+	HeapFile *old_file = frame.file;
+	BlockID old_block_id = frame.block_id;
+	bool write_old = old_file != nullptr && frame.dirty;
+	PageKey new_key = key(file, block_id);
+	this->page_table[new_key] = i;
+	frame.file = file;
+	frame.block_id = block_id;
+	frame.dirty = false;
+	frame.in_flight = true;
+	this->in_flight++;
+	start_io(file);
+	if (write_old)
+		start_io(old_file);
+	uint block_size = file->get_block_size();
+	guard.unlock();
+	bool written = false;
+	try {
+		if (write_old) {
+			old_file->write_block(old_block_id, frame.data);
+			written = true;
+		}
+		if (frame.size < block_size) {
+			delete[] frame.data;
+			frame.data = new char[block_size];
+			frame.size = block_size;
+		}
+		if (image != nullptr)
+			memcpy(frame.data, image, block_size);
+		else if (is_new)
+			memset(frame.data, 0, block_size);
+		else
+			file->read_block(block_id, frame.data);
+	} catch (...) {
+		guard.lock();
+		this->page_table.erase(new_key);
+		if (write_old && !written) {
+			frame.file = old_file;  // still holds the old block, which still needs writing
+			frame.block_id = old_block_id;
+			frame.dirty = true;
+		} else {
+			if (old_file != nullptr)
+				this->page_table.erase(key(old_file, old_block_id));
+			frame.file = nullptr;
+			frame.block_id = 0;
+		}
+		if (written)
+			this->writes++;
+		end_io(file);
+		if (write_old)
+			end_io(old_file);
+		frame.in_flight = false;
+		this->in_flight--;
+		this->io_done.notify_all();
+		throw;
+	}
+	guard.lock();
+	if (old_file != nullptr)
+		this->page_table.erase(key(old_file, old_block_id));
+	if (written)
+		this->writes++;
+	end_io(file);
+	if (write_old)
+		end_io(old_file);
+	frame.in_flight = false;
+	this->in_flight--;
+	this->io_done.notify_all();
+	return frame;
+}
+
+// Wait until no block of a file (or of any file if file is nullptr) is being read or written.
+void BufferPool::wait_for_io(unique_lock<mutex>& guard, const HeapFile* file) {
+	if (file == nullptr)
+		this->io_done.wait(guard, [this] { return this->in_flight == 0; });
+	else
+		this->io_done.wait(guard, [this, file] { return this->file_io.count(file->dbfilename) == 0; });
+}
+
+// Note the start and end of a read or write of a file's block. Caller holds the latch.
+void BufferPool::start_io(const HeapFile* file) {
+	this->file_io[file->dbfilename]++;
+}
+
+void BufferPool::end_io(const HeapFile* file) {
+	auto it = this->file_io.find(file->dbfilename);
+	if (--it->second == 0)
+		this->file_io.erase(it);
+}
+
+// Write back the dirty frames of one file (or of all files if file is nullptr). The page table is
+// ordered by file and block id, so each file's blocks go out in order. The frames are marked in
+// flight and written without the latch; one changed again meanwhile is just dirty again afterward.
+// Caller holds the latch (again, on return).
+void BufferPool::write_dirty(unique_lock<mutex>& guard, const HeapFile* file, bool skip_pinned) {
+	wait_for_io(guard, file);  // a victim of the file may be on its way out
+	vector<uint> dirty;
+	auto it = file == nullptr ? this->page_table.begin() : this->page_table.lower_bound(key(file, 0));
+	for (; it != this->page_table.end(); it++) {
+		if (file != nullptr && it->first.first != file->dbfilename)
+			break;
+		BufferFrame &frame = this->frames[it->second];
+		if (frame.dirty && !(skip_pinned && frame.pin_count > 0)) {
+			frame.dirty = false;
+			frame.in_flight = true;
+			start_io(frame.file);
+			dirty.push_back(it->second);
+		}
+	}
+	if (dirty.empty())
+		return;
+	this->in_flight += (uint)dirty.size();
+	guard.unlock();
+	uint done = 0;
+	try {
+		for (; done < dirty.size(); done++) {
+			BufferFrame &frame = this->frames[dirty[done]];
+			frame.file->write_block(frame.block_id, frame.data);
+		}
+	} catch (...) {
+		guard.lock();
+		for (uint n = done; n < dirty.size(); n++)
+			this->frames[dirty[n]].dirty = true;
+		for (uint i: dirty) {
+			end_io(this->frames[i].file);
+			this->frames[i].in_flight = false;
+		}
+		this->writes += done;
+		this->in_flight -= (uint)dirty.size();
+		this->io_done.notify_all();
+		throw;
+	}
+	guard.lock();
+	for (uint i: dirty) {
+		end_io(this->frames[i].file);
+		this->frames[i].in_flight = false;
+	}
+	this->writes += done;
+	this->in_flight -= (uint)dirty.size();
+	this->io_done.notify_all();
+}
+
+// Background flusher: every interval_ms, write back whatever is dirty and not in use.
+void BufferPool::run_flusher(uint interval_ms) {
+	unique_lock<mutex> guard(this->latch);
+	while (!this->stopping) {
+		this->wake_flusher.wait_for(guard, chrono::milliseconds(interval_ms));
+		if (!this->stopping)
+			write_dirty(guard, nullptr, true);
+	}
+}
+
+ostream& operator<<(ostream& out, const BufferPool& pool) {
+	out << "buffer pool: " << pool.get_frame_count() << " frames, "
+		<< pool.get_hits() << " hits, " << pool.get_misses() << " misses ("
+		<< (int)(pool.hit_rate() * 100.0 + 0.5) << "% hit rate), "
+		<< pool.get_writes() << " writes";
+	return out;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file buffer_pool.h - Buffer manager sitting in front of HeapFile.
+ * BufferFrame
+ * BufferPool
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "storage_engine.h"
+
+class HeapFile;
+class BufferPool;
+
+/**
+ * @class BufferPoolError - thrown when the pool cannot supply a frame
+ */
+class BufferPoolError : public std::runtime_error {
+public:
+	explicit BufferPoolError(std::string s) : runtime_error(s) {}
+};
+
+/**
+ * @class BufferFrame - one slot of the buffer pool.
+ *
+ * Holds the image of a single block of a HeapFile. A frame may only be
+ * evicted once its pin_count has dropped back to zero. Its memory starts out
+ * DbBlock::BLOCK_SZ bytes and grows if a file with bigger blocks needs it.
+ * While in_flight, the frame is being read or written without the pool's latch
+ * and nobody else may touch it.
+ */
+class BufferFrame {
+public:
+	BufferFrame() : data(nullptr), size(0), pool(nullptr), file(nullptr), block_id(0), pin_count(0),
+					dirty(false), referenced(false), in_flight(false) {}
+
+	char *data;          // block image, owned by the pool
+	uint size;           // bytes allocated at data
+	BufferPool *pool;    // pool this frame belongs to
+	HeapFile *file;      // owner of the block in this frame (nullptr if free)
+	BlockID block_id;    // which block of file is in this frame
+	uint pin_count;      // number of outstanding DbBlocks using this frame
+	bool dirty;          // frame has changes not yet written to file
+	bool referenced;     // CLOCK reference bit
+	bool in_flight;      // I/O under way on the frame
+};
+
+/**
+ * @class BufferPool - fixed number of block frames shared by all HeapFiles.
+ *
+ * Blocks are pinned into a frame by pin() and released with unpin(). A pinned
+ * frame is never evicted, so its memory can be used in place by a SlottedPage.
+ * Victims are chosen with the CLOCK algorithm and dirty victims are written
+ * back to their HeapFile before the frame is reused. flush() and flush_all()
+ * act as checkpoints.
+ *
+ * Changes are write-behind: HeapFile::put() only marks the frame dirty. Dirty
+ * frames are written at eviction, at a checkpoint, or by the optional flusher
+ * thread (start_flusher), which periodically writes the unpinned ones. Writes
+ * always go out in block order within each file. The pool's bookkeeping is
+ * guarded by a latch so the flusher can run alongside queries; a pinned frame
+ * is never written by the flusher, so its user may change it without locking.
+ * The latch is not held during I/O: a frame is taken (and marked in flight)
+ * under the latch, then read or written without it, so misses in different
+ * threads overlap. Anyone wanting a block whose frame is in flight waits for it.
+ *
+ * Blocks are known by the name of their file, so HeapFiles opened separately on
+ * the same table share them. Closing any of them forgets the file's frames.
+ */
+class BufferPool {
+public:
+	/**
+	 * Number of frames in the shared pool (4MB with 4kB blocks).
+	 */
+	static const uint DEFAULT_FRAMES = 1024;
+
+	/**
+	 * The pool used by every HeapFile unless told otherwise.
+	 */
+	static BufferPool& shared();
+
+	BufferPool(uint n_frames = DEFAULT_FRAMES);
+	virtual ~BufferPool();
+	BufferPool(const BufferPool& other) = delete;
+	BufferPool(BufferPool&& temp) = delete;
+	BufferPool& operator=(const BufferPool& other) = delete;
+	BufferPool& operator=(BufferPool&& temp) = delete;
+
+	/**
+	 * Get a block into a frame and pin it there.
+	 * @param file      file the block belongs to
+	 * @param block_id  which block
+	 * @param is_new    if true, the block is not read from file but zero-filled
+	 * @returns         pinned frame holding the block (release with unpin)
+	 * @throws          BufferPoolError if every frame is pinned
+	 */
+	virtual BufferFrame* pin(HeapFile* file, BlockID block_id, bool is_new=false);
+
+	/**
+	 * Release one pin on a frame.
+	 * @param frame  frame previously returned by pin()
+	 */
+	virtual void unpin(BufferFrame* frame);
+
+	/**
+	 * Put a block image that was read ahead into a frame, unless the block is already in the pool.
+	 * The frame is left unpinned and unreferenced, so blocks nobody asks for go first.
+	 * Counts as neither a hit nor a miss (the pin that follows is a hit).
+	 * @param file      file the block belongs to
+	 * @param block_id  which block
+	 * @param image     block contents as read from the file
+	 * @returns         false if the block was already in the pool (or no frame was free)
+	 */
+	virtual bool preload(HeapFile* file, BlockID block_id, const void* image);
+
+	/**
+	 * Check whether a block is in the pool (without pinning it or counting a hit).
+	 * @param file      file the block belongs to
+	 * @param block_id  which block
+	 */
+	virtual bool contains(HeapFile* file, BlockID block_id);
+
+	/**
+	 * Note that a resident block has been changed.
+	 * @param file      file the block belongs to
+	 * @param block_id  which block
+	 * @returns         false if the block is not in the pool
+	 */
+	virtual bool mark_dirty(HeapFile* file, BlockID block_id);
+
+	/**
+	 * Write back all the dirty frames of one file (checkpoint of that file).
+	 * @param file  file to flush
+	 */
+	virtual void flush(HeapFile* file);
+
+	/**
+	 * Write back all dirty frames in the pool (checkpoint).
+	 */
+	virtual void flush_all();
+
+	/**
+	 * Start a background thread that writes back dirty, unpinned frames every so often.
+	 * Replaces any flusher already running.
+	 * @param interval_ms  milliseconds between passes
+	 */
+	virtual void start_flusher(uint interval_ms);
+
+	/**
+	 * Stop the background flusher (if any), waiting for its current pass to finish.
+	 */
+	virtual void stop_flusher();
+
+	/**
+	 * Forget all the frames of a file, e.g., when it is closed or dropped.
+	 * Frames still pinned are detached from the file and freed on their last unpin.
+	 * @param file        file whose frames to forget (along with those of any other HeapFile with its name)
+	 * @param write_back  if true, dirty frames are written back first
+	 */
+	virtual void discard(HeapFile* file, bool write_back=true);
+
+	// statistics
+	uint get_frame_count() const { return (uint)this->frames.size(); }
+	bool flusher_running() const { return this->flusher.joinable(); }
+	unsigned long get_hits() const { return this->hits; }
+	unsigned long get_misses() const { return this->misses; }
+	unsigned long get_writes() const { return this->writes; }
+	double hit_rate() const;
+	void reset_stats() { this->hits = this->misses = this->writes = 0; }
+
+protected:
+	typedef std::pair<std::string, BlockID> PageKey;
+	static const uint NO_FRAME = UINT32_MAX;
+
+	std::vector<BufferFrame> frames;
+	std::map<PageKey, uint> page_table;  // (file name, block_id) -> index into frames
+	uint clock_hand;
+	uint in_flight;                  // frames with I/O under way
+	std::map<std::string, uint> file_io;  // file name -> reads and writes of it under way
+	std::atomic<unsigned long> hits;    // statistics may be read without the latch
+	std::atomic<unsigned long> misses;
+	std::atomic<unsigned long> writes;
+	std::mutex latch;                // guards everything above (frame contents excepted, see class comment)
+	std::condition_variable io_done;   // signalled whenever frames stop being in flight
+	std::thread flusher;
+	std::condition_variable wake_flusher;
+	bool stopping;
+
+	static PageKey key(const HeapFile* file, BlockID block_id);
+	virtual void write_dirty(std::unique_lock<std::mutex>& guard, const HeapFile* file, bool skip_pinned);
+	virtual void wait_for_io(std::unique_lock<std::mutex>& guard, const HeapFile* file);
+	virtual void start_io(const HeapFile* file);
+	virtual void end_io(const HeapFile* file);
+	virtual void run_flusher(uint interval_ms);
+	virtual uint victim();
+	virtual BufferFrame& load(std::unique_lock<std::mutex>& guard, uint i, HeapFile* file, BlockID block_id,
+							  const void* image, bool is_new);
+};
+
+std::ostream& operator<<(std::ostream& out, const BufferPool& pool);
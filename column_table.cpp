@@ -0,0 +1,701 @@
+/**
+ * @file column_table.cpp - implementation of:
+ * ColumnTable
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <memory.h>
+#include <algorithm>
+#include <iostream>
+#include "column_table.h"
+using namespace std;
+
+// Fixed-size fields of a segment record are copied in and out, since they needn't be aligned.
+template <typename T>
+static void put_field(string &bytes, T n) {
+	bytes.append((const char*)&n, sizeof(T));
+}
+
+template <typename T>
+static T get_field(const char *&bytes) {
+	T n;
+	memcpy(&n, bytes, sizeof(T));
+	bytes += sizeof(T);
+	return n;
+}
+
+// Bits needed to write any number up to n.
+static uint8_t width_of(uint64_t n) {
+	uint8_t width = 0;
+	while (width < 32 && (n >> width) != 0)
+		width++;
+	return width;
+}
+
+// Append values (as offsets from base), width bits each, low bits first.
+static void pack(string &bytes, const vector<int32_t> &values, int32_t base, uint8_t width) {
+	uint64_t bits = 0;
+	uint n_bits = 0;
+	for (auto n: values) {
+		bits |= (uint64_t)(uint32_t)((int64_t)n - base) << n_bits;
+		n_bits += width;
+		while (n_bits >= 8) {
+			bytes.push_back((char)(bits & 0xFF));
+			bits >>= 8;
+			n_bits -= 8;
+		}
+	}
+	if (n_bits > 0)
+		bytes.push_back((char)(bits & 0xFF));
+}
+
+// Read n values packed by pack().
+static void unpack(const char *bytes, uint n, int32_t base, uint8_t width, vector<int32_t> &values) {
+	const uint64_t mask = (1ULL << width) - 1;
+	uint64_t bits = 0;
+	uint n_bits = 0;
+	for (uint i = 0; i < n; i++) {
+		while (n_bits < width) {
+			bits |= (uint64_t)(uint8_t)*bytes++ << n_bits;
+			n_bits += 8;
+		}
+		values.push_back((int32_t)((int64_t)base + (uint32_t)(bits & mask)));
+		bits >>= width;
+		n_bits -= width;
+	}
+}
+
+ColumnTable::ColumnTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+						 uint block_size) :
+		DbRelation(table_name, column_names, column_attributes), closed(true), rows(0), pending(false), columns(),
+		deleted() {
+	this->columns.resize(column_attributes.size());
+	for (uint i = 0; i < column_attributes.size(); i++) {
+		Column &column = this->columns[i];
+		column.data_type = column_attributes[i].get_data_type();
+		string name = table_name + ".c" + to_string(i);
+		column.file = new HeapFile(name, block_size);
+		column.dictionary = column.data_type == ColumnAttribute::TEXT ? new HeapFile(name + ".dict", block_size) : nullptr;
+		column.segment = NO_SEGMENT;
+	}
+	this->deleted.data_type = ColumnAttribute::BOOLEAN;
+	this->deleted.file = new HeapFile(table_name + ".deleted", block_size);
+	this->deleted.dictionary = nullptr;
+	this->deleted.segment = NO_SEGMENT;
+}
+
+ColumnTable::~ColumnTable() {
+	if (!this->closed)
+		flush();
+	for (auto &column: this->columns) {
+		delete column.file;
+		delete column.dictionary;
+	}
+	delete this->deleted.file;
+}
+
+// Execute: CREATE TABLE <table_name> ( <columns> )
+// Is not responsible for metadata storage or validation.
+void ColumnTable::create() {
+	for (auto &column: this->columns)
+		open_column(column, true);
+	open_column(this->deleted, true);
+	this->rows = 0;
+	this->pending = false;
+	this->closed = false;
+}
+
+// Execute: CREATE TABLE IF NOT EXISTS <table_name> ( <columns> )
+// Is not responsible for metadata storage or validation.
+void ColumnTable::create_if_not_exists() {
+	if (this->deleted.file->exists())
+		open();
+	else
+		create();
+}
+
+// Execute: DROP TABLE <table_name>
+void ColumnTable::drop() {
+	this->pending = false;  // nothing left to write them to
+	for (auto &column: this->columns) {
+		column.file->drop();
+		if (column.dictionary != nullptr)
+			column.dictionary->drop();
+	}
+	this->deleted.file->drop();
+	close();
+}
+
+// Open existing table. Enables: insert, update, delete, select, project
+// The number of rows is the number of deleted flags.
+void ColumnTable::open() {
+	if (!this->closed)
+		return;
+	for (auto &column: this->columns)
+		open_column(column, false);
+	open_column(this->deleted, false);
+	uint32_t last = this->deleted.file->get_last_block_id();
+	this->rows = (last - 1) * SEGMENT_ROWS + (uint32_t)segment(this->deleted, last - 1).size();
+	this->pending = false;
+	this->closed = false;
+}
+
+// Closes the table, first writing any rows not written yet. Disables: insert, update, delete, select, project
+void ColumnTable::close() {
+	if (!this->closed)
+		flush();
+	for (auto &column: this->columns) {
+		column.file->close();
+		if (column.dictionary != nullptr)
+			column.dictionary->close();
+		column.words.clear();
+		column.codes.clear();
+		column.segment = NO_SEGMENT;
+		column.values.clear();
+	}
+	this->deleted.file->close();
+	this->deleted.segment = NO_SEGMENT;
+	this->deleted.values.clear();
+	this->rows = 0;
+	this->closed = true;
+}
+
+// Write the last segment of each column, if it has rows not written yet, and its deleted flags last
+// of all: until those are written, the rows aren't counted.
+void ColumnTable::flush() {
+	if (!this->pending)
+		return;
+	for (auto &column: this->columns)
+		write_segment(column);
+	write_segment(this->deleted);
+	this->pending = false;
+}
+
+// Expect row to be a dictionary with column name keys.
+// Execute: INSERT INTO <table_name> (<row_keys>) VALUES (<row_values>)
+// The row goes on the end of the last segment of each column (a new segment if that one is full),
+// in memory; the segment is written once it is full (see flush()).
+Handle ColumnTable::insert(const ValueDict* row) {
+	open();
+	vector<int32_t> values;
+	values.reserve(this->columns.size());
+	for (uint i = 0; i < this->columns.size(); i++) {
+		ValueDict::const_iterator column = row->find(this->column_names[i]);
+		if (column == row->end())
+			throw DbRelationError("don't know how to handle NULLs, defaults, etc. yet");
+		const Value &value = column->second;
+		if ((value.data_type == ColumnAttribute::TEXT) != (this->columns[i].data_type == ColumnAttribute::TEXT))
+			throw DbRelationError("wrong type of value for column " + this->column_names[i]);
+		if (value.data_type == ColumnAttribute::TEXT &&
+				value.s.length() > this->columns[i].dictionary->get_block_size() - 32)  // 32: block and record headers
+			throw DbRelationError("text field too long to marshal");
+	}
+	for (uint i = 0; i < this->columns.size(); i++) {
+		const Value &value = row->at(this->column_names[i]);
+		if (value.data_type == ColumnAttribute::TEXT)
+			values.push_back((int32_t)code(this->columns[i], value.s));
+		else if (this->columns[i].data_type == ColumnAttribute::BOOLEAN)  // kept as a byte, as in a HeapTable record
+			values.push_back((uint8_t)value.n);
+		else
+			values.push_back(value.n);
+	}
+
+	uint32_t row_id = this->rows;
+	uint32_t s = row_id / SEGMENT_ROWS;
+	for (uint i = 0; i <= this->columns.size(); i++) {
+		Column &column = i < this->columns.size() ? this->columns[i] : this->deleted;
+		segment(column, s);
+		column.values.resize(row_id % SEGMENT_ROWS);  // anything past the last row is left from a failed insert
+		column.values.push_back(i < this->columns.size() ? values[i] : 0);
+	}
+	this->rows++;
+	this->pending = true;
+	if (this->rows % SEGMENT_ROWS == 0)
+		flush();
+	return Handle(s + 1, (RecordID)(row_id % SEGMENT_ROWS + 1));
+}
+
+// Conceptually, execute: UPDATE INTO <table_name> SET <new_values> WHERE <handle>
+void ColumnTable::update(const Handle /*handle*/, const ValueDict* /*new_values*/) {
+	throw DbRelationError("Not implemented");
+}
+
+// Conceptually, execute: DELETE FROM <table_name> WHERE <handle>
+// Only the row's deleted flag changes; its values stay where they are. A row in the last segment
+// with rows not written yet is deleted in memory and written with them.
+void ColumnTable::del(const Handle handle) {
+	open();
+	uint32_t row_id = row_of(handle);
+	const vector<int32_t> &flags = segment(this->deleted, row_id / SEGMENT_ROWS);
+	if (flags[row_id % SEGMENT_ROWS] != 0)
+		throw DbRelationError("no such row");
+	this->deleted.values[row_id % SEGMENT_ROWS] = 1;
+	if (!this->pending)
+		write_segment(this->deleted);
+}
+
+// Conceptually, execute: SELECT <handle> FROM <table_name> WHERE 1
+// Returns a list of handles for qualifying rows.
+Handles* ColumnTable::select() {
+	return select(nullptr);
+}
+
+// Conceptually, execute: SELECT <handle> FROM <table_name> WHERE <where>
+// Returns a list of handles for qualifying rows. Only the where clause's columns are read.
+Handles* ColumnTable::select(const ValueDict* where) {
+	open();
+	Handles* handles = new Handles();
+	Terms terms;
+	if (!this->terms(where, terms))
+		return handles;
+	vector<uint> places;
+	for (uint32_t s = 0; s * SEGMENT_ROWS < this->rows; s++) {
+		matches(s, terms, places);
+		for (auto place: places)
+			handles->push_back(Handle(s + 1, (RecordID)(place + 1)));
+	}
+	return handles;
+}
+
+// Refine another selection.
+Handles* ColumnTable::select(Handles *current_selection, const ValueDict* where) {
+	open();
+	Handles* handles = new Handles();
+	Terms terms;
+	if (!this->terms(where, terms))
+		return handles;
+	for (auto const& handle: *current_selection) {
+		uint32_t row_id;
+		try {
+			row_id = row_of(handle);
+		} catch (DbRelationError &e) {
+			continue;
+		}
+		if (selected(row_id, terms))
+			handles->push_back(handle);
+	}
+	return handles;
+}
+
+// Scan and project in one pass, a segment at a time, decoding just the columns tested or asked for
+// (and those only for segments with rows left to test or project). The scan is always serial, since
+// each column keeps just one segment decoded, so parallelism is not used.
+ValueTuples* ColumnTable::scan_project(const ValueDict* where, const ColumnOrdinals* ordinals, uint /*parallelism*/) {
+	open();
+	ValueTuples* result = new ValueTuples();
+	Terms terms;
+	if (!this->terms(where, terms))
+		return result;
+	for (auto ordinal: *ordinals)
+		if (ordinal >= this->columns.size()) {
+			delete result;
+			throw DbRelationError("no column " + to_string(ordinal) + " to project");
+		}
+	vector<uint> places;
+	vector<const vector<int32_t>*> projected(ordinals->size());
+	for (uint32_t s = 0; s * SEGMENT_ROWS < this->rows; s++) {
+		matches(s, terms, places);
+		if (places.empty())
+			continue;
+		for (uint i = 0; i < ordinals->size(); i++)
+			projected[i] = &segment(this->columns[(*ordinals)[i]], s);
+		for (auto place: places) {
+			ValueTuple* row = new ValueTuple();
+			row->reserve(ordinals->size());
+			for (uint i = 0; i < ordinals->size(); i++)
+				row->push_back(value(this->columns[(*ordinals)[i]], (*projected[i])[place]));
+			result->push_back(row);
+		}
+	}
+	return result;
+}
+
+// Return a sequence of all values for handle.
+ValueDict* ColumnTable::project(Handle handle) {
+	return project(handle, &this->column_names);
+}
+
+// Return a sequence of values for handle given by column_names.
+ValueDict* ColumnTable::project(Handle handle, const ColumnNames* column_names) {
+	if (column_names->empty())
+		return project(handle);
+	ColumnOrdinals* ordinals = get_ordinals(*column_names);
+	ValueTuple* row;
+	try {
+		row = project(handle, ordinals);
+	} catch (...) {
+		delete ordinals;
+		throw;
+	}
+	ValueDict* result = new ValueDict();
+	for (uint i = 0; i < ordinals->size(); i++)
+		(*result)[(*column_names)[i]] = (*row)[i];
+	delete row;
+	delete ordinals;
+	return result;
+}
+
+// Return the values for handle at the given column positions.
+ValueTuple* ColumnTable::project(Handle handle, const ColumnOrdinals* ordinals) {
+	open();
+	uint32_t row_id = row_of(handle);
+	uint32_t s = row_id / SEGMENT_ROWS;
+	if (segment(this->deleted, s)[row_id % SEGMENT_ROWS] != 0)
+		throw DbRelationError("no such row");
+	ValueTuple* result = new ValueTuple();
+	result->reserve(ordinals->size());
+	for (auto ordinal: *ordinals) {
+		if (ordinal >= this->columns.size()) {
+			delete result;
+			throw DbRelationError("no column " + to_string(ordinal) + " to project");
+		}
+		Column &column = this->columns[ordinal];
+		result->push_back(value(column, segment(column, s)[row_id % SEGMENT_ROWS]));
+	}
+	return result;
+}
+
+// Create or open a column's files. A new column starts with an empty first segment.
+void ColumnTable::open_column(Column &column, bool create) {
+	column.segment = NO_SEGMENT;
+	column.values.clear();
+	column.words.clear();
+	column.codes.clear();
+	if (create) {
+		column.file->create();
+		string bytes = encode(column.data_type, column.values);
+		Dbt data((void*)bytes.data(), (uint32_t)bytes.size());
+		SlottedPage* block = column.file->get(1);  // made empty by create()
+		block->add(&data);
+		column.file->put(block);
+		delete block;
+		if (column.dictionary != nullptr)
+			column.dictionary->create();
+	} else {
+		column.file->open();
+		if (column.dictionary != nullptr) {
+			column.dictionary->open();
+			load_dictionary(column);
+		}
+	}
+}
+
+// Read a TEXT column's dictionary: its records, in order, are the values of codes 0, 1, ...
+void ColumnTable::load_dictionary(Column &column) {
+	for (BlockID block_id = 1; block_id <= column.dictionary->get_last_block_id(); block_id++) {
+		SlottedPage* block = column.dictionary->get(block_id);
+		RecordIDs* record_ids = block->ids();
+		for (auto record_id: *record_ids) {
+			RecordView data = block->view(record_id);
+			string word(data.get_data(), data.get_size());
+			column.codes[word] = (uint32_t)column.words.size();
+			column.words.push_back(word);
+		}
+		delete record_ids;
+		delete block;
+	}
+}
+
+// A column's values for a segment (empty for one not written yet), decoded unless they already are.
+// Rows not written yet are written first if the column has to let go of their segment.
+const vector<int32_t>& ColumnTable::segment(Column &column, uint32_t segment) {
+	if (column.segment == segment)
+		return column.values;
+	flush();
+	column.values.clear();
+	column.segment = segment;
+	if (segment + 1 <= column.file->get_last_block_id()) {
+		SlottedPage* block = column.file->get(segment + 1);
+		try {
+			decode(column.data_type, block->view(1), column.values);
+		} catch (...) {
+			delete block;
+			column.segment = NO_SEGMENT;
+			throw;
+		}
+		delete block;
+	}
+	return column.values;
+}
+
+// Write a column's decoded segment back to its block (a new one for a new segment).
+void ColumnTable::write_segment(Column &column) {
+	string bytes = encode(column.data_type, column.values);
+	Dbt data((void*)bytes.data(), (uint32_t)bytes.size());
+	SlottedPage* block;
+	if (column.segment + 1 > column.file->get_last_block_id()) {
+		block = column.file->get_new();
+		block->add(&data);
+	} else {
+		block = column.file->get(column.segment + 1);
+		block->put(1, data);
+	}
+	column.file->put(block);
+	delete block;
+}
+
+// The code for a TEXT value, adding it to the column's dictionary if it is new.
+uint32_t ColumnTable::code(Column &column, const string &value) {
+	auto found = column.codes.find(value);
+	if (found != column.codes.end())
+		return found->second;
+	Dbt data((void*)value.data(), (uint32_t)value.size());
+	SlottedPage* block = column.dictionary->get(column.dictionary->get_last_block_id());
+	try {
+		block->add(&data);
+	} catch (DbBlockNoRoomError &e) {
+		delete block;
+		block = column.dictionary->get_new();
+		block->add(&data);
+	}
+	column.dictionary->put(block);
+	delete block;
+	uint32_t code = (uint32_t)column.words.size();
+	column.codes[value] = code;
+	column.words.push_back(value);
+	return code;
+}
+
+// The value kept as n in a column.
+Value ColumnTable::value(const Column &column, int32_t n) const {
+	if (column.data_type == ColumnAttribute::TEXT)
+		return Value(column.words.at((uint32_t)n));
+	Value value(n);
+	value.data_type = column.data_type;
+	return value;
+}
+
+// Turn a where clause into what its columns' values (or codes) must be.
+// Returns false if no row can satisfy it: a value of the wrong type, or text the column has never had.
+bool ColumnTable::terms(const ValueDict* where, Terms &terms) const {
+	if (where == nullptr)
+		return true;
+	ColumnOrdinals* ordinals = get_ordinals(*where);
+	uint i = 0;
+	bool possible = true;
+	for (auto const& column: *where) {
+		const Column &to_test = this->columns[(*ordinals)[i]];
+		const Value &value = column.second;
+		Term term;
+		term.column = (*ordinals)[i++];
+		if (value.data_type != to_test.data_type) {
+			possible = false;
+			break;
+		}
+		if (value.data_type == ColumnAttribute::TEXT) {
+			auto found = to_test.codes.find(value.s);
+			if (found == to_test.codes.end()) {
+				possible = false;
+				break;
+			}
+			term.wanted = (int32_t)found->second;
+		} else if (value.data_type == ColumnAttribute::BOOLEAN) {
+			term.wanted = (uint8_t)value.n;
+		} else {
+			term.wanted = value.n;
+		}
+		terms.push_back(term);
+	}
+	delete ordinals;
+	return possible;
+}
+
+// Find the places in a segment of the rows that are there (not deleted) and satisfy the terms.
+// The terms are tested a column at a time, each on the rows that passed the ones before.
+void ColumnTable::matches(uint32_t segment, const Terms &terms, vector<uint> &places) {
+	places.clear();
+	const vector<int32_t> &flags = this->segment(this->deleted, segment);
+	for (uint i = 0; i < flags.size(); i++)
+		if (flags[i] == 0)
+			places.push_back(i);
+	for (auto const& term: terms) {
+		if (places.empty())
+			return;
+		const vector<int32_t> &values = this->segment(this->columns[term.column], segment);
+		uint kept = 0;
+		for (auto place: places)
+			if (values[place] == term.wanted)
+				places[kept++] = place;
+		places.resize(kept);
+	}
+}
+
+// Check if a row is there (not deleted) and satisfies the terms.
+bool ColumnTable::selected(uint32_t row_id, const Terms &terms) {
+	uint32_t s = row_id / SEGMENT_ROWS;
+	uint32_t i = row_id % SEGMENT_ROWS;
+	if (segment(this->deleted, s)[i] != 0)
+		return false;
+	for (auto const& term: terms)
+		if (segment(this->columns[term.column], s)[i] != term.wanted)
+			return false;
+	return true;
+}
+
+// The row ordinal of a handle. Throws for a handle that isn't one of the table's rows.
+uint32_t ColumnTable::row_of(Handle handle) const {
+	if (handle.first < 1 || handle.second < 1 || handle.second > SEGMENT_ROWS)
+		throw DbRelationError("no such row");
+	uint64_t row_id = (uint64_t)(handle.first - 1) * SEGMENT_ROWS + handle.second - 1;
+	if (row_id >= this->rows)
+		throw DbRelationError("no such row");
+	return (uint32_t)row_id;
+}
+
+// A segment's record (see the class comment for the layout of each data type).
+string ColumnTable::encode(ColumnAttribute::DataType data_type, const vector<int32_t> &values) {
+	string bytes;
+	put_field<uint16_t>(bytes, (uint16_t)values.size());
+	if (data_type == ColumnAttribute::BOOLEAN) {
+		vector<pair<uint8_t, uint16_t>> runs;
+		for (auto n: values)
+			if (!runs.empty() && runs.back().first == (uint8_t)n)
+				runs.back().second++;
+			else
+				runs.push_back(make_pair((uint8_t)n, (uint16_t)1));
+		put_field<uint16_t>(bytes, (uint16_t)runs.size());
+		for (auto const& run: runs) {
+			put_field<uint8_t>(bytes, run.first);
+			put_field<uint16_t>(bytes, run.second);
+		}
+	} else if (data_type == ColumnAttribute::TEXT) {
+		int32_t most = values.empty() ? 0 : *max_element(values.begin(), values.end());
+		uint8_t width = width_of((uint32_t)most);
+		put_field<uint8_t>(bytes, width);
+		pack(bytes, values, 0, width);
+	} else {
+		int32_t low = 0, high = 0;
+		if (!values.empty()) {
+			low = *min_element(values.begin(), values.end());
+			high = *max_element(values.begin(), values.end());
+		}
+		uint8_t width = width_of((uint64_t)((int64_t)high - low));
+		put_field<int32_t>(bytes, low);
+		put_field<uint8_t>(bytes, width);
+		pack(bytes, values, low, width);
+	}
+	return bytes;
+}
+
+// Read a segment's values (or codes) out of its record.
+void ColumnTable::decode(ColumnAttribute::DataType data_type, RecordView data, vector<int32_t> &values) {
+	if (data.is_null())
+		throw DbRelationError("column segment missing");
+	const char *bytes = data.get_data();
+	uint16_t n = get_field<uint16_t>(bytes);
+	values.reserve(n);
+	if (data_type == ColumnAttribute::BOOLEAN) {
+		uint16_t n_runs = get_field<uint16_t>(bytes);
+		for (uint16_t r = 0; r < n_runs; r++) {
+			uint8_t value = get_field<uint8_t>(bytes);
+			uint16_t length = get_field<uint16_t>(bytes);
+			values.insert(values.end(), length, value);
+		}
+	} else if (data_type == ColumnAttribute::TEXT) {
+		uint8_t width = get_field<uint8_t>(bytes);
+		unpack(bytes, n, 0, width, values);
+	} else {
+		int32_t low = get_field<int32_t>(bytes);
+		uint8_t width = get_field<uint8_t>(bytes);
+		unpack(bytes, n, low, width, values);
+	}
+}
+
+// test function -- returns true if all tests pass
+bool test_column_table() {
+	ColumnNames column_names({"a", "b", "c"});
+	ColumnAttributes column_attributes({ColumnAttribute(ColumnAttribute::INT), ColumnAttribute(ColumnAttribute::TEXT),
+										ColumnAttribute(ColumnAttribute::BOOLEAN)});
+	ValueDict row;
+	Handles* handles;
+	int i;
+	cout << "test_column_table: " << endl;
+
+	// a column table gives back what it was given, across segments and a reopen, extremes included
+	ColumnTable columnar("_test_column_cpp", column_names, column_attributes);
+	columnar.create();
+	Handles column_handles;
+	for (i = 0; i < 1100; i++) {
+		test_set_row(row, i - 600, "value " + to_string(i % 50));
+		column_handles.push_back(columnar.insert(&row));
+	}
+	test_set_row(row, INT32_MIN, "");
+	column_handles.push_back(columnar.insert(&row));
+	test_set_row(row, INT32_MAX, string(200, 'x'));
+	column_handles.push_back(columnar.insert(&row));
+	bool columnar_ok = column_handles[513] == Handle(2, 2);
+	ValueDict by_column;
+	by_column["a"] = Value("wrong");
+	try {
+		columnar.insert(&by_column);
+		columnar_ok = false;
+	} catch (DbRelationError &e) {}
+	for (uint reopened = 0; reopened < 2; reopened++) {
+		columnar_ok = columnar_ok && columnar.get_row_count() == 1102
+					  && test_compare(columnar, column_handles[0], -600, "value 0")
+					  && test_compare(columnar, column_handles[777], 177, "value 27")
+					  && test_compare(columnar, column_handles[1100], INT32_MIN, "")
+					  && test_compare(columnar, column_handles[1101], INT32_MAX, string(200, 'x'));
+		by_column.clear();
+		by_column["b"] = Value("value 7");
+		handles = columnar.select(&by_column);
+		columnar_ok = columnar_ok && handles->size() == 22 && handles->at(1) == column_handles[57];
+		delete handles;
+		by_column["b"] = Value("nowhere");
+		handles = columnar.select(&by_column);
+		columnar_ok = columnar_ok && handles->empty();
+		delete handles;
+		by_column.clear();
+		by_column["a"] = Value(100);
+		handles = columnar.select(&by_column);
+		columnar_ok = columnar_ok && handles->size() == 1 - reopened  // deleted before the reopen
+					  && (reopened == 1 || handles->front() == column_handles[700]);
+		delete handles;
+		by_column["c"] = Value(0);  // INT isn't BOOLEAN
+		handles = columnar.select(&by_column);
+		columnar_ok = columnar_ok && handles->empty();
+		delete handles;
+		by_column["c"].data_type = ColumnAttribute::BOOLEAN;
+		by_column["c"].n = 1;
+		by_column.erase("a");
+		ColumnOrdinals just_b({1});
+		ValueTuples* evens = columnar.scan_project(&by_column, &just_b);
+		columnar_ok = columnar_ok && evens->size() == 551 - reopened  // one even row deleted before the reopen
+					  && (*evens)[1]->size() == 1 && (*(*evens)[1])[0] == Value("value 2");
+		for (auto projected: *evens)
+			delete projected;
+		delete evens;
+		if (reopened == 0) {
+			columnar.del(column_handles[700]);
+			columnar.close();
+			columnar.open();
+		}
+	}
+	try {
+		columnar.project(column_handles[700]);
+		columnar_ok = false;
+	} catch (DbRelationError &e) {}
+	try {
+		columnar.project(Handle(3, 100));  // past the last row
+		columnar_ok = false;
+	} catch (DbRelationError &e) {}
+	handles = columnar.select();
+	columnar_ok = columnar_ok && handles->size() == 1101;
+	delete handles;
+	test_set_row(row, 5, "value 5");
+	Handle after = columnar.insert(&row);
+	columnar_ok = columnar_ok && after == Handle(3, 79) && test_compare(columnar, after, 5, "value 5");
+	columnar.del(column_handles[1101]);  // in the last segment, not written yet
+	columnar.close();
+	columnar.open();
+	try {
+		columnar.project(column_handles[1101]);
+		columnar_ok = false;
+	} catch (DbRelationError &e) {}
+	columnar_ok = columnar_ok && columnar.get_row_count() == 1103 && test_compare(columnar, after, 5, "value 5");
+	columnar.drop();
+	if (!columnar_ok)
+		return false;
+	cout << "column table ok" << endl;
+	return true;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file column_table.h - Column storage engine (implementation of DbRelation)
+ * ColumnTable
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "storage_engine.h"
+#include "heap_storage.h"
+
+/**
+ * @class ColumnTable - a table kept a column at a time, for queries that read a few of its columns.
+ *
+ * Rows are numbered in the order they are inserted and grouped into segments of SEGMENT_ROWS.
+ * Each column has its own HeapFile (<table>.c<ordinal>.db) with the column's values for segment
+ * s in block s + 1, as the block's one record, encoded for the column's data type:
+ *      INT:     bit-packed offsets from the segment's lowest value
+ *          Bytes 0x00 - 0x01: number of values, n
+ *          Bytes 0x02 - 0x05: lowest value
+ *          Byte  0x06:        bits per value, w (0 if all the values are the same)
+ *          then n w-bit values (value minus lowest), low bits first
+ *      BOOLEAN: run-length encoded
+ *          Bytes 0x00 - 0x01: number of values, n
+ *          Bytes 0x02 - 0x03: number of runs, r
+ *          then r runs of 3 bytes: the value (1 byte), then how many times it repeats (2 bytes)
+ *      TEXT:    dictionary codes, bit-packed
+ *          Bytes 0x00 - 0x01: number of values, n
+ *          Byte  0x02:        bits per code, w
+ *          then n w-bit codes, low bits first
+ * A TEXT column's dictionary is another HeapFile (<table>.c<ordinal>.dict.db) with one record per
+ * distinct value, in the order they were first seen; a value's code is its place in that order.
+ * Dictionaries are read into memory when the table is opened.
+ * Deleted rows are marked in one more, BOOLEAN, column (<table>.deleted.db), which also gives
+ * the number of rows.
+ *
+ * A row's handle is (segment + 1, place in the segment + 1), so row ordinal r is
+ * Handle(r / SEGMENT_ROWS + 1, r % SEGMENT_ROWS + 1). Only the columns asked for are ever
+ * decoded; the segment of each column decoded last is kept decoded, so a scan decodes each
+ * segment of a column once. Inserted rows are added to the last segment in memory and written
+ * when that segment is full, when another segment is read, or on flush() or close(); a row not
+ * yet written is lost if the program stops first. As for HeapTable, updates are not implemented.
+ */
+class ColumnTable : public DbRelation {
+public:
+	static const uint SEGMENT_ROWS = 512;
+
+	ColumnTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+				uint block_size=DbBlock::BLOCK_SZ);
+	virtual ~ColumnTable();
+	ColumnTable(const ColumnTable& other) = delete;
+	ColumnTable(ColumnTable&& temp) = delete;
+	ColumnTable& operator=(const ColumnTable& other) = delete;
+	ColumnTable& operator=(ColumnTable&& temp) = delete;
+
+	virtual void create();
+	virtual void create_if_not_exists();
+	virtual void drop();
+
+	virtual void open();
+	virtual void close();
+
+	/**
+	 * Write the rows inserted since the last segment was written.
+	 */
+	virtual void flush();
+
+	virtual Handle insert(const ValueDict* row);
+	virtual void update(const Handle handle, const ValueDict* new_values);
+	virtual void del(const Handle handle);
+
+	virtual Handles* select();
+	virtual Handles* select(const ValueDict* where);
+	virtual Handles* select(Handles *current_selection, const ValueDict* where);
+	virtual ValueTuples* scan_project(const ValueDict* where, const ColumnOrdinals* ordinals, uint parallelism=1);
+	virtual ValueDict* project(Handle handle);
+	virtual ValueDict* project(Handle handle, const ColumnNames* column_names);
+	virtual ValueTuple* project(Handle handle, const ColumnOrdinals* ordinals);
+	using DbRelation::project;
+
+	/**
+	 * Number of rows inserted, deleted ones included.
+	 */
+	virtual uint32_t get_row_count() { open(); return rows; }
+
+protected:
+	struct Column {
+		ColumnAttribute::DataType data_type;
+		HeapFile *file;                    // one block per segment
+		HeapFile *dictionary;              // TEXT only
+		std::vector<std::string> words;    // TEXT: value of each code
+		std::unordered_map<std::string, uint32_t> codes;  // TEXT: code of each value
+		uint32_t segment;                  // segment in values (NO_SEGMENT for none)
+		std::vector<int32_t> values;       // a segment's values (or codes), decoded
+	};
+	static const uint32_t NO_SEGMENT = UINT32_MAX;
+
+	// a term of a where clause: the column's value (or code) must be wanted
+	struct Term {
+		uint column;
+		int32_t wanted;
+	};
+	typedef std::vector<Term> Terms;
+
+	bool closed;
+	uint32_t rows;
+	bool pending;  // the last segment has rows not written yet (every column has it decoded)
+	std::vector<Column> columns;
+	Column deleted;
+
+	virtual void open_column(Column &column, bool create);
+	virtual void load_dictionary(Column &column);
+	virtual const std::vector<int32_t>& segment(Column &column, uint32_t segment);
+	virtual void write_segment(Column &column);
+	virtual uint32_t code(Column &column, const std::string &value);
+	virtual Value value(const Column &column, int32_t n) const;
+	virtual bool terms(const ValueDict* where, Terms &terms) const;
+	virtual void matches(uint32_t segment, const Terms &terms, std::vector<uint> &places);
+	virtual bool selected(uint32_t row, const Terms &terms);
+	virtual uint32_t row_of(Handle handle) const;
+
+	static std::string encode(ColumnAttribute::DataType data_type, const std::vector<int32_t> &values);
+	static void decode(ColumnAttribute::DataType data_type, RecordView data, std::vector<int32_t> &values);
+};
+
+bool test_column_table();
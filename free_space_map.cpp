@@ -0,0 +1,234 @@
+/**
+ * @file free_space_map.cpp - implementation of:
+ * FreeSpaceMap
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <memory.h>
+#include "free_space_map.h"
+using namespace std;
+
+FreeSpaceMap::FreeSpaceMap(string name, uint block_size) : dbfilename(name + ".fsm.db"), closed(true), db(_DB_ENV, 0),
+		category_sz(block_size / CATEGORIES), loaded(false), mapped(0), first_map_page(FIRST_MAP_PAGE), allocated(0),
+		record_format(0), page_layout(0), categories(),
+		page_max(), dirty(), header_dirty(false) {
+}
+
+// Create the fork with an empty map.
+void FreeSpaceMap::create(void) {
+	db_open(DB_CREATE|DB_EXCL);
+	this->loaded = true;
+	this->header_dirty = true;
+	flush();
+}
+
+// Delete the fork.
+void FreeSpaceMap::drop(void) {
+	this->categories.clear();
+	this->page_max.clear();
+	this->dirty.clear();
+	this->header_dirty = false;
+	this->loaded = false;
+	this->allocated = 0;
+	close();
+	Db db(_DB_ENV, 0);
+	db.remove(this->dbfilename.c_str(), nullptr, 0);
+}
+
+// Open the fork and read its header. The map itself waits for load().
+void FreeSpaceMap::open(void) {
+	if (!this->closed)
+		return;
+	db_open();
+
+	char buffer[DbBlock::BLOCK_SZ];
+	read_page(HEADER, buffer);
+	uint32_t version = *(uint32_t*)(buffer + 4);
+	if (*(uint32_t*)buffer != MAGIC || version < 1 || version > VERSION)
+		throw DbRelationError(this->dbfilename + " is not a free-space map");
+	this->mapped = *(uint32_t*)(buffer + 8);
+	if (version >= 2) {
+		set_block_size(*(uint32_t*)(buffer + 12));
+		this->first_map_page = *(uint32_t*)(buffer + 16);
+		this->allocated = *(uint32_t*)(buffer + 20);
+		this->record_format = version >= 3 ? *(uint32_t*)(buffer + 24) : 0;
+		this->page_layout = version >= 4 ? *(uint32_t*)(buffer + 28) : 0;
+	} else {
+		this->first_map_page = FIRST_MAP_PAGE;
+		this->allocated = 0;
+		this->record_format = 0;
+		this->page_layout = 0;
+	}
+	this->loaded = false;
+	this->header_dirty = version < VERSION;
+}
+
+// Read the map pages into memory.
+void FreeSpaceMap::load(void) {
+	if (this->loaded)
+		return;
+	uint32_t n = this->mapped;
+	uint n_pages = (n + ENTRIES_PER_PAGE - 1) / ENTRIES_PER_PAGE;
+	this->categories.assign(n, 0);
+	this->page_max.assign(n_pages, 0);
+	this->dirty.assign(n_pages, false);
+	char buffer[DbBlock::BLOCK_SZ];
+	for (uint page = 0; page < n_pages; page++) {
+		read_page(this->first_map_page + page, buffer);
+		uint first = page * ENTRIES_PER_PAGE;
+		for (uint i = 0; i < ENTRIES_PER_PAGE && first + i < n; i++)
+			this->categories[first + i] = (buffer[i/2] >> (4 * (i%2))) & 0x0F;
+		recompute_max(page);
+	}
+	this->loaded = true;
+}
+
+// Write out any changes and close the fork.
+void FreeSpaceMap::close(void) {
+	if (this->closed)
+		return;
+	flush();
+	this->db.close(0);
+	this->closed = true;
+	this->loaded = false;
+}
+
+// Write the header and the changed map pages.
+void FreeSpaceMap::flush(void) {
+	if (this->closed)
+		return;
+	char buffer[DbBlock::BLOCK_SZ];
+	for (uint page = 0; page < this->dirty.size(); page++) {
+		if (!this->dirty[page])
+			continue;
+		memset(buffer, 0, sizeof(buffer));
+		uint first = page * ENTRIES_PER_PAGE;
+		for (uint i = 0; i < ENTRIES_PER_PAGE && first + i < this->categories.size(); i++)
+			buffer[i/2] |= (char)(this->categories[first + i] << (4 * (i%2)));
+		write_page(this->first_map_page + page, buffer);
+		this->dirty[page] = false;
+	}
+	if (this->header_dirty) {
+		memset(buffer, 0, sizeof(buffer));
+		*(uint32_t*)buffer = MAGIC;
+		*(uint32_t*)(buffer + 4) = VERSION;
+		*(uint32_t*)(buffer + 8) = (uint32_t)get_block_count();
+		*(uint32_t*)(buffer + 12) = this->category_sz * CATEGORIES;
+		*(uint32_t*)(buffer + 16) = this->first_map_page;
+		*(uint32_t*)(buffer + 20) = get_allocated();
+		*(uint32_t*)(buffer + 24) = this->record_format;
+		*(uint32_t*)(buffer + 28) = this->page_layout;
+		write_page(HEADER, buffer);
+		this->header_dirty = false;
+	}
+}
+
+void FreeSpaceMap::sync(void) {
+	if (this->closed)
+		return;
+	flush();
+	this->db.sync(0);
+}
+
+// Note the room left in a block, growing the map if this is a block we haven't seen.
+void FreeSpaceMap::set(BlockID block_id, uint free_bytes) {
+	load();
+	uint i = block_id - 1;
+	uint page = i / ENTRIES_PER_PAGE;
+	uint8_t category = (uint8_t)min(free_bytes / this->category_sz, CATEGORIES - 1);
+	if (i >= this->categories.size()) {
+		this->categories.resize(i + 1, 0);
+		this->page_max.resize(page + 1, 0);
+		this->dirty.resize(page + 1, true);
+		this->header_dirty = true;
+	}
+	uint8_t old = this->categories[i];
+	if (old == category)
+		return;
+	this->categories[i] = category;
+	this->dirty[page] = true;
+	if (category > this->page_max[page])
+		this->page_max[page] = category;
+	else if (old == this->page_max[page])
+		recompute_max(page);
+}
+
+void FreeSpaceMap::set_allocated(BlockID allocated) {
+	if (allocated == this->allocated)
+		return;
+	this->allocated = allocated;
+	this->header_dirty = true;
+}
+
+void FreeSpaceMap::set_record_format(uint32_t record_format) {
+	if (record_format == this->record_format)
+		return;
+	this->record_format = record_format;
+	this->header_dirty = true;
+}
+
+void FreeSpaceMap::set_page_layout(uint32_t page_layout) {
+	if (page_layout == this->page_layout)
+		return;
+	this->page_layout = page_layout;
+	this->header_dirty = true;
+}
+
+// First fit: lowest-numbered block whose category guarantees size bytes.
+BlockID FreeSpaceMap::find(uint size) {
+	load();
+	uint needed = (size + this->category_sz - 1) / this->category_sz;
+	if (needed >= CATEGORIES)
+		return 0;
+	for (uint page = 0; page < this->page_max.size(); page++) {
+		if (this->page_max[page] < needed)
+			continue;
+		uint first = page * ENTRIES_PER_PAGE;
+		uint last = min((uint)this->categories.size(), first + ENTRIES_PER_PAGE);
+		for (uint i = first; i < last; i++)
+			if (this->categories[i] >= needed)
+				return i + 1;
+	}
+	return 0;
+}
+
+uint FreeSpaceMap::get(BlockID block_id) {
+	load();
+	if (block_id == 0 || block_id > this->categories.size())
+		return 0;
+	return this->categories[block_id - 1] * this->category_sz;
+}
+
+// Wrapper for Berkeley DB open, which does both open and creation.
+void FreeSpaceMap::db_open(uint flags) {
+	if (!this->closed)
+		return;
+	this->db.set_re_len(DbBlock::BLOCK_SZ);
+	this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
+	this->closed = false;
+}
+
+void FreeSpaceMap::read_page(uint page, char *buffer) {
+	Dbt key(&page, sizeof(page));
+	Dbt data;
+	data.set_data(buffer);
+	data.set_ulen(DbBlock::BLOCK_SZ);
+	data.set_flags(DB_DBT_USERMEM);
+	if (this->db.get(nullptr, &key, &data, 0) != 0)
+		throw DbRelationError("free-space map page " + to_string(page) + " missing from " + this->dbfilename);
+}
+
+void FreeSpaceMap::write_page(uint page, const char *buffer) {
+	Dbt key(&page, sizeof(page));
+	Dbt data((void*)buffer, DbBlock::BLOCK_SZ);
+	this->db.put(nullptr, &key, &data, 0);
+}
+
+void FreeSpaceMap::recompute_max(uint page) {
+	uint first = page * ENTRIES_PER_PAGE;
+	uint last = min((uint)this->categories.size(), first + ENTRIES_PER_PAGE);
+	uint8_t highest = 0;
+	for (uint i = first; i < last; i++)
+		highest = max(highest, this->categories[i]);
+	this->page_max[page] = highest;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file free_space_map.h - Free-space map kept next to each HeapFile.
+ * FreeSpaceMap
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "db_cxx.h"
+#include "storage_engine.h"
+
+/**
+ * @class FreeSpaceMap - how much room each block of a HeapFile has left.
+ *
+ * Stored in its own Berkeley DB RecNo file (the "fsm fork", <name>.fsm.db) so the
+ * heap file's block numbering is unaffected:
+ *      Block 1: header, which is also the heap file's metadata page
+ *          Bytes 0x00 - 0x03: magic number
+ *          Bytes 0x04 - 0x07: format version
+ *          Bytes 0x08 - 0x0B: number of heap blocks mapped (the heap file's last block id)
+ *          Bytes 0x0C - 0x0F: heap block size
+ *          Bytes 0x10 - 0x13: first map page
+ *          Bytes 0x14 - 0x17: heap blocks allocated, counting empty ones not yet handed out (0 if none)
+ *          Bytes 0x18 - 0x1B: format of the records in the heap file (0 for the original one)
+ *          Bytes 0x1C - 0x1F: layout of the heap file's blocks (0 for the original one, plus flags)
+ *      Block 2...: map pages, 4 bits per heap block (low nibble first)
+ * Version 1 headers stop after byte 0x0B, version 2 headers after byte 0x17 and version 3
+ * headers after byte 0x1B; they are rewritten as version 4 at the next flush.
+ *
+ * Each entry is a free-space category: the block's free bytes in units of
+ * (heap block size)/CATEGORIES, rounded down. Lookups are therefore conservative--a
+ * block is only suggested if it really has at least the requested room.
+ * open() reads just the header, so a heap file can learn its size from one page.
+ * The map pages are read in the first time the map is used and then kept in memory
+ * while open; dirty map pages are written on flush() and close().
+ */
+class FreeSpaceMap {
+public:
+	/**
+	 * Number of free-space categories (fits in 4 bits)
+	 */
+	static const uint CATEGORIES = 16;
+
+	FreeSpaceMap(std::string name, uint block_size=DbBlock::BLOCK_SZ);
+	virtual ~FreeSpaceMap() {}
+	FreeSpaceMap(const FreeSpaceMap& other) = delete;
+	FreeSpaceMap(FreeSpaceMap&& temp) = delete;
+	FreeSpaceMap& operator=(const FreeSpaceMap& other) = delete;
+	FreeSpaceMap& operator=(FreeSpaceMap&& temp) = delete;
+
+	virtual void create(void);
+	virtual void drop(void);
+
+	/**
+	 * Open an existing map (reading only its header page).
+	 * @throws  DbException if the map does not exist (e.g., file made before we kept maps)
+	 */
+	virtual void open(void);
+
+	/**
+	 * Check if the fork has been created.
+	 */
+	virtual bool exists(void) const {return db_file_exists(this->dbfilename);}
+	virtual void close(void);
+
+	/**
+	 * Write out any changed map pages.
+	 */
+	virtual void flush(void);
+
+	/**
+	 * Flush and force the fork to disk.
+	 */
+	virtual void sync(void);
+
+	/**
+	 * Record how much room a block has.
+	 * @param block_id    heap block
+	 * @param free_bytes  room available for a new record in the block
+	 */
+	virtual void set(BlockID block_id, uint free_bytes);
+
+	/**
+	 * Find a block with room for a new record.
+	 * @param size  bytes needed
+	 * @returns     a block with at least size free bytes, or 0 if there isn't one
+	 */
+	virtual BlockID find(uint size);
+
+	/**
+	 * Lower bound on the free bytes in a block, according to the map.
+	 * @param block_id  heap block
+	 * @returns         free bytes (0 if the block is not mapped)
+	 */
+	virtual uint get(BlockID block_id);
+
+	/**
+	 * Number of heap blocks covered by the map, i.e., the last block id of the heap file
+	 * as of the last flush.
+	 */
+	virtual BlockID get_block_count() const {return this->loaded ? (BlockID)this->categories.size() : this->mapped;}
+
+	/**
+	 * Number of blocks the heap file has allocated, including its reserve of empty blocks.
+	 * @returns  last allocated block id (never less than get_block_count())
+	 */
+	virtual BlockID get_allocated() const {return std::max(this->allocated, get_block_count());}
+
+	/**
+	 * Record how many blocks the heap file has allocated (written to the header at the next flush).
+	 * @param allocated  last allocated block id
+	 */
+	virtual void set_allocated(BlockID allocated);
+
+	/**
+	 * Format of the records kept in the heap file (up to the file's user; 0 if never set).
+	 */
+	virtual uint32_t get_record_format() const {return this->record_format;}
+
+	/**
+	 * Record the format of the heap file's records (written to the header at the next flush).
+	 * @param record_format  format number
+	 */
+	virtual void set_record_format(uint32_t record_format);
+
+	/**
+	 * Layout of the heap file's blocks (up to the file's user; 0 if never set).
+	 */
+	virtual uint32_t get_page_layout() const {return this->page_layout;}
+
+	/**
+	 * Record the layout of the heap file's blocks (written to the header at the next flush).
+	 * @param page_layout  layout number
+	 */
+	virtual void set_page_layout(uint32_t page_layout);
+
+	/**
+	 * Size of the heap file's blocks, which sets the bytes per category.
+	 * @param block_size  bytes per heap block
+	 */
+	virtual void set_block_size(uint block_size) {this->category_sz = block_size / CATEGORIES;}
+
+protected:
+	static const uint32_t MAGIC = 0x46534D31;  // "FSM1"
+	static const uint32_t VERSION = 4;
+	static const BlockID HEADER = 1;
+	static const BlockID FIRST_MAP_PAGE = HEADER + 1;
+	static const uint ENTRIES_PER_PAGE = DbBlock::BLOCK_SZ * 2;
+
+	std::string dbfilename;
+	bool closed;
+	Db db;
+	uint category_sz;
+	bool loaded;                      // map pages have been read in
+	BlockID mapped;                   // number of heap blocks according to the header
+	BlockID first_map_page;
+	BlockID allocated;                // heap blocks allocated according to the header
+	uint32_t record_format;
+	uint32_t page_layout;
+	std::vector<uint8_t> categories;  // category of block_id at [block_id - 1]
+	std::vector<uint8_t> page_max;    // highest category on each map page
+	std::vector<bool> dirty;          // map pages needing a write
+	bool header_dirty;
+
+	virtual void db_open(uint flags=0);
+	virtual void load(void);
+	virtual void read_page(uint page, char *buffer);
+	virtual void write_page(uint page, const char *buffer);
+	virtual void recompute_max(uint page);
+};
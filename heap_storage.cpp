@@ -10,70 +10,158 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
 #include "heap_storage.h"
+#include "mmap_file.h"
+#include "pax_page.h"
 using namespace std;
 
 typedef uint16_t u16;
 
-SlottedPage::SlottedPage(Dbt &block, BlockID block_id, bool is_new) : DbBlock(block, block_id, is_new) {
+SlottedPage::SlottedPage(Dbt &block, BlockID block_id, bool is_new, BufferFrame *frame, bool defer_compaction)
+		: DbBlock(block, block_id, is_new),
+		  block_end((u16)(min(block.get_size(), (u_int32_t)UINT16_MAX) - 1)), frame(frame),
+		  defer_compaction(defer_compaction) {
 	if (is_new) {
 		this->num_records = 0;
-		this->end_free = DbBlock::BLOCK_SZ - 1;
+		this->end_free = this->block_end;
+		this->first_free = 0;
+		this->header_size = HEADER_SZ;
 		put_header();
 	} else {
 		get_header(this->num_records, this->end_free);
+		if (get_n(6) == FORMAT) {
+			this->header_size = HEADER_SZ;
+			this->first_free = get_n(4);
+		} else {
+			// block written before the header had a free-slot hint
+			this->header_size = LEGACY_HEADER_SZ;
+			this->first_free = next_free(0);
+		}
 	}
 }
 
+SlottedPage::SlottedPage(Dbt &block, BlockID block_id, BufferFrame *frame)
+		: DbBlock(block, block_id), num_records(0), end_free(0), first_free(0), header_size(HEADER_SZ),
+		  block_end((u16)(min(block.get_size(), (u_int32_t)UINT16_MAX) - 1)), frame(frame),
+		  defer_compaction(false) {
+}
+
+// Release our pin on the buffer frame (if we came from the buffer pool).
+SlottedPage::~SlottedPage() {
+	if (this->frame != nullptr)
+		this->frame->pool->unpin(this->frame);
+}
+
 // Add a new record to the block. Return its id.
+// The id of a deleted record is reused if there is one (and then no new header is needed).
 RecordID SlottedPage::add(const Dbt* data) throw(DbBlockNoRoomError) {
-	if (!has_room((u16)data->get_size()))
+	char *bytes;
+	RecordID id = add(data->get_size(), &bytes);
+	memcpy(bytes, data->get_data(), data->get_size());
+	return id;
+}
+
+// Add a new record of the given size, leaving its bytes for the caller to fill in. Return its id.
+// The room check is done before narrowing to 16 bits, since near 64kB the size plus its slot overflows.
+// (A subclass that doesn't keep a record's bytes together throws std::logic_error instead; see PaxPage.)
+RecordID SlottedPage::add(uint record_size, char **bytes) throw(DbBlockNoRoomError, std::logic_error) {
+	RecordID id = this->first_free;
+	if (record_size > this->block_end || !make_room(id != 0 ? record_size : record_size + 4))
 		throw DbBlockNoRoomError("not enough room for new record");
-	u16 id = ++this->num_records;
-	u16 size = (u16) data->get_size();
+	u16 size = (u16) record_size;
+	if (id == 0)
+		id = ++this->num_records;
+	else
+		this->first_free = next_free(id);
 	this->end_free -= size;
 	u16 loc = this->end_free + 1U;
 	put_header();
 	put_header(id, size, loc);
-	memcpy(this->address(loc), data->get_data(), size);
+	*bytes = (char*)this->address(loc);
 	return id;
 }
 
 // Get a record from the block. Return None if it has been deleted.
 Dbt* SlottedPage::get(RecordID record_id) const {
+	RecordView data = view(record_id);
+    if (data.is_null())
+        return nullptr;  // this is just a tombstone, record has been deleted
+    return new Dbt((void*)data.get_data(), data.get_size());
+}
+
+// Look at a record where it sits in the block. Null if it has been deleted.
+RecordView SlottedPage::view(RecordID record_id) const {
 	u16 size, loc;
     get_header(size, loc, record_id);
     if (loc == 0)
-        return nullptr;  // this is just a tombstone, record has been deleted
-    return new Dbt(this->address(loc), size);
+        return RecordView();  // this is just a tombstone, record has been deleted
+    return RecordView((const char*)this->address(loc), size);
 }
 
 // Replace the record with the given data. Raises DbBlockNoRoomError if it won't fit.
 void SlottedPage::put(RecordID record_id, const Dbt &data) throw(DbBlockNoRoomError) {
 	u16 size, loc;
     get_header(size, loc, record_id);
+    if (data.get_size() > this->block_end)
+		throw DbBlockNoRoomError("not enough room for enlarged record");
     u16 new_size = (u16) data.get_size();
     if (new_size > size) {
         u16 extra = new_size - size;
-        if (!has_room(extra))
+        if (!make_room(extra))
     		throw DbBlockNoRoomError("not enough room for enlarged record");
+        get_header(size, loc, record_id);  // compaction may have moved it
 		slide(loc, loc - extra);
-		memcpy(this->address(loc-extra), data.get_data(), new_size);
+		loc -= extra;
+		memcpy(this->address(loc), data.get_data(), new_size);
 	} else {
 		memcpy(this->address(loc), data.get_data(), new_size);
-        slide(loc+new_size, loc+size);
+		if (!this->defer_compaction)
+	        slide(loc+new_size, loc+size);
+	    get_header(size, loc, record_id);
 	}
-    get_header(size, loc, record_id);
     put_header(record_id, new_size, loc);
 }
 
 // Mark the given id as deleted by changing its size to zero and its location to 0.
-// Compact the rest of the data in the block. But keep the record ids the same for everyone.
+// Compact the rest of the data in the block (unless deferring that until the room is needed).
+// The other records keep their ids; the deleted id becomes available to add() again.
 void SlottedPage::del(RecordID record_id) {
 	u16 size, loc;
     get_header(size, loc, record_id);
+    if (loc == 0)
+        return;  // already deleted
     put_header(record_id, 0, 0);
-    slide(loc, loc+size);
+    if (!this->defer_compaction) {
+        slide(loc, loc+size);
+    } else if (loc == this->end_free + 1U && size > 0) {
+        // lowest record in the block, so its bytes just rejoin the free space
+        // (empty records sitting at the same spot move up with the new end of free space)
+        this->end_free += size;
+        for (RecordID id = 1; id <= this->num_records; id++) {
+            u16 other_size, other_loc;
+            get_header(other_size, other_loc, id);
+            if (other_loc == loc)
+                put_header(id, 0, this->end_free + 1U);
+        }
+    }
+
+    if (record_id == this->num_records) {
+        // drop trailing tombstones so the slot array only covers live records
+        while (this->num_records > 0 && get_n((u16)(slot_offset(this->num_records) + 2)) == 0)
+            this->num_records--;
+        if (this->first_free > this->num_records)
+            this->first_free = 0;
+    } else if (this->first_free == 0 || record_id < this->first_free) {
+        this->first_free = record_id;
+    }
+    put_header();
 }
 
 // Sequence of all non-deleted record IDs.
@@ -88,60 +176,172 @@ RecordIDs* SlottedPage::ids(void) const {
 	return vec;
 }
 
+/**
+ * @class SlottedPageIDs - the live record ids of a SlottedPage, read off its headers as they are asked for.
+ * The record count is re-read each time, so deletes through another SlottedPage on the same
+ * buffer frame (e.g., by HeapTable::del during a scan) are seen.
+ */
+class SlottedPageIDs : public RecordIDIterator {
+public:
+	SlottedPageIDs(const SlottedPage *page) : page(page), record_id(0) {}
+
+	virtual bool next(RecordID &item) {
+		u16 size, loc;
+		while (this->record_id < this->page->get_n(0)) {
+			this->record_id++;
+			this->page->get_header(size, loc, this->record_id);
+			if (loc != 0) {
+				item = this->record_id;
+				return true;
+			}
+		}
+		return false;
+	}
+
+protected:
+	const SlottedPage *page;
+	RecordID record_id;  // last one handed out
+};
+
+RecordIDIterator* SlottedPage::scan_ids(void) const {
+	return new SlottedPageIDs(this);
+}
+
+// Room for a new record (leaving space for its header unless a deleted slot can be reused),
+// counting space a compaction would recover.
+uint SlottedPage::free_space(void) const {
+	int headers = this->header_size + 4*this->num_records + (this->first_free == 0 ? 4 : 0);
+	int available;
+	if (this->defer_compaction)
+		available = (int)this->block_end + 1 - headers - (int)data_size();
+	else
+		available = (int)this->end_free + 1 - headers;
+	return available > 0 ? (uint)available : 0;
+}
+
 // Get the size and offset for given id. For id of zero, it is the block header.
 void SlottedPage::get_header(u16 &size, u16 &loc, RecordID id) const {
-	size = get_n((u16) 4*id);
-	loc = get_n((u16)(4*id + 2));
+	if (id == 0) {
+		size = get_n(0);
+		loc = get_n(2);
+	} else {
+		size = get_n(slot_offset(id));
+		loc = get_n((u16)(slot_offset(id) + 2));
+	}
 }
 
 // Store the size and offset for given id. For id of zero, store the block header.
 void SlottedPage::put_header(RecordID id, u16 size, u16 loc) {
 	if (id == 0) {
-		size = this->num_records;
-		loc = this->end_free;
+		put_n(0, this->num_records);
+		put_n(2, this->end_free);
+		if (this->header_size == HEADER_SZ) {
+			put_n(4, this->first_free);
+			put_n(6, FORMAT);
+		}
+	} else {
+		put_n(slot_offset(id), size);
+		put_n((u16)(slot_offset(id) + 2), loc);
 	}
-	put_n((u16)4*id, size);
-	put_n((u16)(4*id + 2), loc);
+}
+
+// Offset of the header for the given record id.
+u16 SlottedPage::slot_offset(RecordID id) const {
+	return (u16)(this->header_size + 4*(id - 1));
+}
+
+// Lowest deleted record id after the given one, or 0 if there are none.
+RecordID SlottedPage::next_free(RecordID id) const {
+	for (RecordID record_id = id + 1; record_id <= this->num_records; record_id++)
+		if (get_n((u16)(slot_offset(record_id) + 2)) == 0)
+			return record_id;
+	return 0;
 }
 
 // Calculate if we have room to store a record with given size. The size should include the 4 bytes
 // for the header, too, if this is an add.
-bool SlottedPage::has_room(u16 size) const {
-	u16 available = this->end_free - (u16)(4*(this->num_records+1));
-	return size <= available;
+bool SlottedPage::has_room(uint size) const {
+	int available = (int)this->end_free + 1 - (this->header_size + 4*this->num_records);
+	return (int)size <= available;
+}
+
+// Like has_room, but if compaction has been deferred and squeezing out the dead space would make
+// enough room, then compact first.
+bool SlottedPage::make_room(uint size) {
+	if (has_room(size))
+		return true;
+	if (!this->defer_compaction)
+		return false;
+	int available = (int)this->block_end + 1 - (this->header_size + 4*this->num_records) - (int)data_size();
+	if ((int)size > available)
+		return false;
+	compact();
+	return true;
+}
+
+// Total bytes of record data in the block (deleted records have size zero).
+uint SlottedPage::data_size(void) const {
+	uint total = 0;
+	for (RecordID record_id = 1; record_id <= this->num_records; record_id++)
+		total += get_n(slot_offset(record_id));
+	return total;
 }
 
 // If start < end, then remove data from offset start up to but not including offset end by sliding data
 // that is to the left of start to the right. If start > end, then make room for extra data from end to start
 // by sliding data that is to the left of start to the left.
 // Also fix up any record headers whose data has slid. Assumes there is enough room if it is a left
-// shift (end < start).
+// shift (end < start). On a left shift, a record with data located exactly at start stays put since its
+// data doesn't move (if it is the record being enlarged, put() relocates it); empty records there do move,
+// so they stay on the boundary below it.
 void SlottedPage::slide(u16 start, u16 end) {
     int shift = end - start;
     if (shift == 0)
         return;
 
-    // slide data
-    void *to = this->address((u16)(this->end_free + 1 + shift));
-    void *from = this->address((u16)(this->end_free + 1));
-    int bytes = start - (this->end_free + 1U);
-    char temp[bytes];
-    memcpy(temp, from, bytes);
-    memcpy(to, temp, bytes);
-
-    // fix up headers
-    RecordIDs* record_ids = ids();
-	for (auto const& record_id : *record_ids) {
-		u16 size, loc;
+    // slide data (source and destination overlap)
+    uint first = this->end_free + 1U;
+    memmove(this->address((u16)(first + shift)), this->address((u16)first), start - first);
+
+    // fix up headers in one pass over the slots (tombstones have loc 0)
+    u16 size, loc;
+    for (RecordID record_id = 1; record_id <= this->num_records; record_id++) {
+        get_header(size, loc, record_id);
+        if (loc != 0 && (loc < start || (loc == start && (shift > 0 || size == 0))))
+            put_header(record_id, size, (u16)(loc + shift));
+    }
+    this->end_free += shift;
+    put_header();
+}
+
+// Pack the live records against the end of the block, squeezing out the space of records deleted
+// while compaction was deferred. Works from the highest offset down so nothing is overwritten
+// before it has moved.
+void SlottedPage::compact(void) {
+	vector<RecordID> order;
+	order.reserve(this->num_records);
+	u16 size, loc;
+	for (RecordID record_id = 1; record_id <= this->num_records; record_id++) {
 		get_header(size, loc, record_id);
-		if (loc <= start) {
-			loc += shift;
-			put_header(record_id, size, loc);
+		if (loc != 0)
+			order.push_back(record_id);
+	}
+	uint n = (uint)order.size();
+	sort(order.begin(), order.end(), [this](RecordID a, RecordID b) {
+		return this->get_n((u16)(slot_offset(a) + 2)) > this->get_n((u16)(slot_offset(b) + 2));
+	});
+
+	uint dest = this->block_end + 1U;
+	for (uint i = 0; i < n; i++) {
+		get_header(size, loc, order[i]);
+		dest -= size;
+		if (dest != loc) {
+			memmove(this->address((u16)dest), this->address(loc), size);
+			put_header(order[i], size, (u16)dest);
 		}
 	}
-    delete record_ids;
-    this->end_free += shift;
-    put_header();
+	this->end_free = (u16)(dest - 1);
+	put_header();
 }
 
 // Get 2-byte integer at given offset in block.
@@ -166,66 +366,129 @@ void* SlottedPage::address(u16 offset) const {
  * *******************
  */
 
-HeapFile::HeapFile(string name) : DbFile(name), dbfilename(""), last(0), closed(true), db(_DB_ENV, 0) {
+HeapFile::HeapFile(string name, uint block_size, BufferPool &pool) : DbFile(name), dbfilename(""), last(0),
+		allocated(0), extent_blocks(DEFAULT_EXTENT), record_format(0), page_layout(SLOTTED_PAGES), defer_compaction(false), pax_widths(), block_size(block_size), closed(true), db(_DB_ENV, 0), pool(pool), fsm(name, block_size),
+		scan_latch(), shared_scans(0), scan_position(0) {
+	if (!DbBlock::is_valid_size(block_size))
+		throw DbRelationError("invalid block size " + to_string(block_size));
 	this->dbfilename = this->name + ".db";
 }
 
+// Close the file if it is still open, so no buffer frames are left pointing at it.
+HeapFile::~HeapFile() {
+	if (!this->closed)
+		close();
+}
+
 // Create physical file.
 void HeapFile::create(void) {
 	db_open(DB_CREATE|DB_EXCL);
+	this->fsm.set_record_format(this->record_format);
+	this->fsm.set_page_layout(this->page_layout | (this->defer_compaction ? DEFERRED_COMPACTION : 0));
+	this->fsm.create();
 	SlottedPage *page = get_new(); // force one page to exist
 	delete page;
 }
 
 // Delete the physical file.
 void HeapFile::drop(void) {
+	this->pool.discard(this, false);  // no point in writing back blocks of a file we're removing
+	this->fsm.drop();
 	close();
 	Db db(_DB_ENV, 0);
 	db.remove(this->dbfilename.c_str(), nullptr, 0);
 }
 
-// Open physical file.
+// Open physical file. How many blocks it has comes from the metadata page (see fsm_open).
 void HeapFile::open(void) {
+	if (!this->closed)
+		return;
     db_open();
+    fsm_open();
 }
 
 // Close the physical file.
 void HeapFile::close(void) {
+	if (!this->closed)
+		this->pool.discard(this);
+	this->fsm.close();
 	this->db.close(0);
 	this->closed = true;
 }
 
 // Allocate a new block for the database file.
 // Returns the new empty DbBlock that is managing the records in this block and its block id.
+// The block comes from the reserve of empty blocks already in the file, which is refilled an extent at a time.
 SlottedPage* HeapFile::get_new(void) {
-	char block[DbBlock::BLOCK_SZ];
-	memset(block, 0, sizeof(block));
-	Dbt data(block, sizeof(block));
+	if (this->last == this->allocated)
+		extend();
+	BlockID block_id = ++this->last;
+	BufferFrame *frame = this->pool.pin(this, block_id, true);
+	Dbt data(frame->data, this->block_size);
+	SlottedPage* page = make_page(data, block_id, true, frame);  // same as what extend() wrote
+	this->fsm.set(block_id, page->free_space());
+	return page;
+}
 
-	int block_id = ++this->last;
-	Dbt key(&block_id, sizeof(block_id));
+// Append extent_blocks empty blocks to the file with one bulk put, so Berkeley DB's record numbers
+// stay dense, and note them in the metadata page so they're handed out after a reopen.
+void HeapFile::extend(void) {
+	char *image = new char[this->block_size];
+	memset(image, 0, this->block_size);
+	Dbt image_data(image, this->block_size);
+	delete make_page(image_data, 0, true);
 
-	// write out an empty block and read it back in so Berkeley DB is managing the memory
-	SlottedPage* page = new SlottedPage(data, this->last, true);
-	this->db.put(nullptr, &key, &data, 0); // write it out with initialization done to it
-	delete page;
-	this->db.get(nullptr, &key, &data, 0);
-	return new SlottedPage(data, this->last);
+	uint32_t bulk_size = (this->extent_blocks + 1) * this->block_size;  // the blocks plus Berkeley DB's bookkeeping
+	char *bulk = new char[bulk_size];
+	Dbt records;
+	records.set_data(bulk);
+	records.set_ulen(bulk_size);
+	records.set_flags(DB_DBT_USERMEM | DB_DBT_BULK);
+	DbMultipleRecnoDataBuilder builder(records);
+	for (uint i = 1; i <= this->extent_blocks; i++)
+		builder.append(this->allocated + i, image, this->block_size);
+	Dbt ignored;
+	try {
+		this->db.put(nullptr, &records, &ignored, DB_MULTIPLE_KEY);
+	} catch (...) {
+		delete[] bulk;
+		delete[] image;
+		throw;
+	}
+	delete[] bulk;
+	delete[] image;
+	this->allocated += this->extent_blocks;
+	this->fsm.set_allocated(this->allocated);
 }
 
-// Get a block from the database file.
+// Get a block from the database file (pinned in the buffer pool until the page is deleted).
 SlottedPage* HeapFile::get(BlockID block_id) {
-	Dbt key(&block_id, sizeof(block_id));
-	Dbt data;
-	this->db.get(nullptr, &key, &data, 0);
-	return new SlottedPage(data, block_id, false);
+	BufferFrame *frame = this->pool.pin(this, block_id);
+	Dbt data(frame->data, this->block_size);
+	return make_page(data, block_id, false, frame);
+}
+
+// Manage a block with the file's layout.
+SlottedPage* HeapFile::make_page(Dbt &data, BlockID block_id, bool is_new, BufferFrame *frame) {
+	if (this->page_layout == PAX_PAGES)
+		return new PaxPage(data, block_id, this->pax_widths, is_new, frame);
+	return new SlottedPage(data, block_id, is_new, frame, this->defer_compaction);
 }
 
 // Write a block back to the database file.
+// Blocks from the buffer pool are just marked dirty; they get written at eviction or checkpoint.
 void HeapFile::put(DbBlock* block) {
-	int block_id = block->get_block_id();
-	Dbt key(&block_id, sizeof(block_id));
-	this->db.put(nullptr, &key, block->get_block(), 0);
+	if (!this->pool.mark_dirty(this, block->get_block_id()))
+		write_block(block->get_block_id(), block->get_data());
+	this->fsm.set(block->get_block_id(), block->free_space());
+}
+
+// Get a block that the free-space map says has room, or a new one if none do.
+SlottedPage* HeapFile::get_with_room(uint size) {
+	BlockID block_id = this->fsm.find(size);
+	if (block_id == 0)
+		return get_new();
+	return get(block_id);
 }
 
 // Sequence of all block ids.
@@ -236,6 +499,112 @@ BlockIDs* HeapFile::block_ids() const {
 	return vec;
 }
 
+BlockScan* HeapFile::scan(bool shared) {
+	return new BlockScan(this, shared);
+}
+
+// A shared scan starts at the block the other shared scans are on (if there are any).
+BlockID HeapFile::join_scan() {
+	lock_guard<mutex> guard(this->scan_latch);
+	BlockID start = this->shared_scans > 0 && this->scan_position > 0 ? this->scan_position : 1;
+	this->shared_scans++;
+	return start;
+}
+
+void HeapFile::leave_scan() {
+	lock_guard<mutex> guard(this->scan_latch);
+	if (this->shared_scans > 0 && --this->shared_scans == 0)
+		this->scan_position = 0;
+}
+
+void HeapFile::report_scan(BlockID block_id) {
+	lock_guard<mutex> guard(this->scan_latch);
+	this->scan_position = block_id;
+}
+
+// Read up to count blocks with a Berkeley DB bulk cursor and load them into the buffer
+// pool--unless the first of them is already there (a resident copy may be newer than the file's,
+// and likely another scan is just ahead), in which case it's the run already there that's ready.
+uint HeapFile::read_ahead(BlockID first, uint count) {
+	if (first == 0 || first > this->last)
+		return 0;
+	count = min(count, this->last - first + 1);
+	count = max(1U, min(count, this->pool.get_frame_count() / 2));  // don't push out what we just read
+	uint cached = 0;
+	while (cached < count && this->pool.contains(this, first + cached))
+		cached++;
+	if (cached > 0)
+		return cached;
+	uint32_t bulk_size = (count + 1) * this->block_size;  // room for the blocks and Berkeley DB's bookkeeping
+	char *bulk = new char[bulk_size];
+	Dbt data;
+	data.set_data(bulk);
+	data.set_ulen(bulk_size);
+	data.set_flags(DB_DBT_USERMEM);
+	db_recno_t recno = first;
+	Dbt key(&recno, sizeof(recno));
+	Dbc *cursor;
+	this->db.cursor(nullptr, &cursor, 0);
+	uint n = 0;
+	u_int32_t flags = DB_SET | DB_MULTIPLE_KEY;
+	try {
+		while (n < count && cursor->get(&key, &data, flags) == 0) {
+			DbMultipleRecnoDataIterator records(data);
+			db_recno_t block_id;
+			Dbt block;
+			while (n < count && records.next(block_id, block)) {
+				this->pool.preload(this, block_id, block.get_data());
+				n++;
+			}
+			flags = DB_NEXT | DB_MULTIPLE_KEY;
+		}
+	} catch (...) {
+		cursor->close();
+		delete[] bulk;
+		throw;
+	}
+	cursor->close();
+	delete[] bulk;
+	return n;
+}
+
+/**
+ * @class HeapFileBlockIDs - block ids 1 through the file's last, including blocks added along the way.
+ */
+class HeapFileBlockIDs : public BlockIDIterator {
+public:
+	HeapFileBlockIDs(HeapFile *file) : file(file), block_id(0) {}
+
+	virtual bool next(BlockID &item) {
+		if (this->block_id >= this->file->get_last_block_id())
+			return false;
+		item = ++this->block_id;
+		return true;
+	}
+
+protected:
+	HeapFile *file;
+	BlockID block_id;  // last one handed out
+};
+
+BlockIDIterator* HeapFile::scan_block_ids() const {
+	return new HeapFileBlockIDs((HeapFile*)this);
+}
+
+// Checkpoint this file's dirty blocks.
+void HeapFile::flush(void) {
+	this->pool.flush(this);
+	this->fsm.flush();
+}
+
+// Checkpoint, then have Berkeley DB force the file (and its free-space map) to disk.
+void HeapFile::sync(void) {
+	flush();
+	this->db.sync(0);
+	this->fsm.sync();
+}
+
+// Count the blocks the slow way (Db::stat walks the whole file).
 uint32_t HeapFile::get_block_count() {
 	DB_BTREE_STAT* stat;
 	this->db.stat(nullptr, &stat, DB_FAST_STAT);
@@ -246,13 +615,161 @@ uint32_t HeapFile::get_block_count() {
 void HeapFile::db_open(uint flags) {
     if (!this->closed)
         return;
-    this->db.set_re_len(DbBlock::BLOCK_SZ); // record length - will be ignored if file already exists
-    this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
+    this->db.set_re_len(this->block_size); // record length - will be ignored if file already exists
+    // free-threaded, since the buffer pool's flusher thread may write blocks while we read
+    this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags | DB_THREAD, 0644);
+    if (!flags) {
+        // an existing file keeps the block size it was created with
+        u_int32_t re_len;
+        this->db.get_re_len(&re_len);
+        this->block_size = re_len;
+        this->fsm.set_block_size(re_len);
+    }
 
-	this->last = flags ? 0 : get_block_count();
+	this->last = this->allocated = 0;  // for an existing file, set by fsm_open
     this->closed = false;
 }
 
+// Open the free-space map, whose header doubles as this file's metadata page: it says how many
+// blocks there are without counting them. If the header is behind (blocks were added after the
+// last checkpoint) or missing (the file predates it), count them and bring the map up to date.
+void HeapFile::fsm_open() {
+	if (this->fsm.exists()) {
+		this->fsm.open();
+		this->record_format = this->fsm.get_record_format();
+		this->page_layout = this->fsm.get_page_layout() & ~DEFERRED_COMPACTION;
+		this->defer_compaction = (this->fsm.get_page_layout() & DEFERRED_COMPACTION) != 0;
+		this->last = this->fsm.get_block_count();
+		this->allocated = this->fsm.get_allocated();
+		if (this->last == 0 || has_block(this->allocated + 1)) {
+			// a reserve written since the checkpoint can't be told from used blocks, so it just becomes blocks
+			BlockID mapped = this->last;
+			this->last = this->allocated = get_block_count();
+			this->fsm.set_allocated(this->allocated);
+			for (BlockID block_id = mapped + 1; block_id <= this->last; block_id++) {
+				SlottedPage* page = get(block_id);
+				this->fsm.set(block_id, page->free_space());
+				delete page;
+			}
+			this->fsm.flush();
+		}
+	} else {
+		this->record_format = 0;  // the file predates recording it
+		this->page_layout = SLOTTED_PAGES;
+		this->defer_compaction = false;
+		this->last = this->allocated = get_block_count();
+		this->fsm.set_record_format(this->record_format);
+		this->fsm.set_page_layout(this->page_layout);
+		this->fsm.create();
+		for (BlockID block_id = 1; block_id <= this->last; block_id++) {
+			SlottedPage* page = get(block_id);
+			this->fsm.set(block_id, page->free_space());
+			delete page;
+		}
+		this->fsm.flush();
+	}
+}
+
+// Check for a block without reading it (a zero-length partial get).
+bool HeapFile::has_block(BlockID block_id) {
+	Dbt key(&block_id, sizeof(block_id));
+	Dbt data;
+	data.set_flags(DB_DBT_USERMEM | DB_DBT_PARTIAL);
+	data.set_doff(0);
+	data.set_dlen(0);
+	data.set_ulen(0);
+	return this->db.get(nullptr, &key, &data, 0) == 0;
+}
+
+// Read a block from Berkeley DB straight into the given buffer (a buffer pool frame).
+void HeapFile::read_block(BlockID block_id, void *buffer) {
+	Dbt key(&block_id, sizeof(block_id));
+	Dbt data;
+	data.set_data(buffer);
+	data.set_ulen(this->block_size);
+	data.set_flags(DB_DBT_USERMEM);
+	if (this->db.get(nullptr, &key, &data, 0) != 0)
+		throw DbRelationError("block " + to_string(block_id) + " not found in " + this->dbfilename);
+}
+
+// Write a block image from the given buffer to Berkeley DB.
+void HeapFile::write_block(BlockID block_id, const void *buffer) {
+	Dbt key(&block_id, sizeof(block_id));
+	Dbt data((void*)buffer, this->block_size);
+	this->db.put(nullptr, &key, &data, 0);
+}
+
+
+/*
+ * *******************
+ * BlockScan class
+ * *******************
+ */
+
+atomic<unsigned long> BlockScan::blocks_read(0);
+atomic<unsigned long> BlockScan::blocks_skipped(0);
+
+BlockScan::BlockScan(HeapFile *file, bool shared) : file(file), next_id(1), ready_to(0), last_id(0), start_id(1),
+		shared(shared), wrapped(false), filter(nullptr), read(0), skipped(0) {
+	if (shared) {
+		this->start_id = this->next_id = file->join_scan();
+		this->ready_to = this->start_id - 1;
+	}
+	this->file->advise_sequential(true);
+}
+
+BlockScan::BlockScan(HeapFile *file, BlockID first, BlockID last) : file(file), next_id(first), ready_to(first - 1),
+		last_id(last), start_id(first), shared(false), wrapped(false), filter(nullptr), read(0), skipped(0) {
+	this->file->advise_sequential(true);
+}
+
+BlockScan::~BlockScan() {
+	blocks_read += this->read;
+	blocks_skipped += this->skipped;
+	this->file->advise_sequential(false);
+	if (this->shared)
+		this->file->leave_scan();
+}
+
+SlottedPage* BlockScan::next() {
+	BlockID last;
+	while (true) {
+		if (this->wrapped)
+			last = this->start_id - 1;
+		else
+			last = this->last_id != 0 ? this->last_id : this->file->get_last_block_id();
+		if (this->next_id > last && this->shared && !this->wrapped && this->start_id > 1) {
+			// joined another scan part way: now for the blocks before where we came in
+			this->wrapped = true;
+			this->next_id = 1;
+			this->ready_to = 0;
+			last = this->start_id - 1;
+		}
+		if (this->next_id > last)
+			return nullptr;
+		if (this->filter == nullptr || this->filter->wanted(this->next_id))
+			break;
+		this->next_id++;
+		this->skipped++;
+	}
+	if (this->shared)
+		this->file->report_scan(this->next_id);
+	if (this->next_id > this->ready_to) {
+		// read ahead as far as the blocks are wanted
+		uint left = last - this->next_id + 1;
+		uint count = left < READ_AHEAD ? left : READ_AHEAD;
+		if (this->filter != nullptr)
+			for (uint n = 1; n < count; n++)
+				if (!this->filter->wanted(this->next_id + n)) {
+					count = n;
+					break;
+				}
+		this->ready_to = this->next_id - 1 + this->file->read_ahead(this->next_id, count);
+	}
+	this->read++;
+	return this->file->get(this->next_id++);
+}
+
 
 /*
  * *******************
@@ -260,39 +777,103 @@ void HeapFile::db_open(uint flags) {
  * *******************
  */
 
-HeapTable::HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes ) :
-		DbRelation(table_name, column_names, column_attributes), file(table_name) {
+HeapTable::HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+					 uint block_size, Storage storage, Layout layout) :
+		DbRelation(table_name, column_names, column_attributes), file(nullptr), toast(nullptr), toast_ready(false),
+		codec(column_attributes), zones(column_attributes), blooms(table_name, column_attributes),
+		blooms_ready(false), pax(false) {
+	if (storage == MMAP) {
+		this->file = new MmapFile(table_name, block_size);
+		this->toast = new MmapFile(table_name + ".toast", block_size);
+	} else {
+		this->file = new HeapFile(table_name, block_size);
+		this->toast = new HeapFile(table_name + ".toast", block_size);
+	}
+	vector<u16> widths;  // of the values in PAX minipages, should the table's file have them
+	for (auto &ca: column_attributes) {
+		switch (ca.get_data_type()) {
+			case ColumnAttribute::INT:
+				widths.push_back(sizeof(int32_t));
+				break;
+			case ColumnAttribute::BOOLEAN:
+				widths.push_back(sizeof(uint8_t));
+				break;
+			default:
+				widths.push_back(0);
+		}
+	}
+	this->file->set_pax_widths(widths);
+	if (layout == PAX)
+		this->file->set_page_layout(HeapFile::PAX_PAGES);
+}
+
+HeapTable::~HeapTable() {
+	delete this->file;
+	delete this->toast;
 }
 
 // Execute: CREATE TABLE <table_name> ( <columns> )
 // Is not responsible for metadata storage or validation.
 void HeapTable::create() {
-	file.create();
+	this->file->set_record_format(RowCodec::CURRENT_FORMAT);  // PAX blocks take records in this format
+	this->file->create();
+	this->codec.set_format(RowCodec::CURRENT_FORMAT);
+	this->pax = this->file->get_page_layout() == HeapFile::PAX_PAGES;
+	this->zones.clear(true);
+	if (this->blooms.exists())
+		this->blooms.drop();  // left from a table of the same name
+	this->blooms_ready = true;
 }
 
 // Execute: CREATE TABLE IF NOT EXISTS <table_name> ( <columns> )
 // Is not responsible for metadata storage or validation.
 void HeapTable::create_if_not_exists() {
-	try {
+	if (this->file->exists())
 		open();
-	} catch (DbException& e) {
+	else
 		create();
-	}
 }
 
 // Execute: DROP TABLE <table_name>
 void HeapTable::drop() {
-	file.drop();
+	this->file->drop();
+	if (this->toast_ready || this->toast->exists())
+		this->toast->drop();
+	this->toast_ready = false;
+	this->zones.clear();
+	if (this->blooms.is_open() || this->blooms.exists())
+		this->blooms.drop();
+	this->blooms_ready = false;
 }
 
 // Open existing table. Enables: insert, update, delete, select, project
 void HeapTable::open() {
-	file.open();
+	this->file->open();
+	this->codec.set_format(this->file->get_record_format());
+	this->pax = this->file->get_page_layout() == HeapFile::PAX_PAGES;
+	if (this->pax && this->codec.get_format() != RowCodec::FORMAT_OFFSETS)
+		throw DbRelationError(this->table_name + " has PAX blocks but not offsets-format records");
+	if (!this->blooms_ready)
+		open_blooms();
+}
+
+// Force the table's changes to disk.
+void HeapTable::sync() {
+	this->file->sync();
+	if (this->toast_ready)
+		this->toast->sync();
+	this->blooms.sync();
 }
 
 // Closes the table. Disables: insert, update, delete, select, project
 void HeapTable::close() {
-	file.close();
+	this->file->close();
+	if (this->toast_ready)
+		this->toast->close();
+	this->toast_ready = false;
+	this->zones.clear();
+	this->blooms.close();
+	this->blooms_ready = false;
 }
 
 // Expect row to be a dictionary with column name keys.
@@ -300,8 +881,14 @@ void HeapTable::close() {
 // Return the handle of the inserted row.
 Handle HeapTable::insert(const ValueDict* row) {
     open();
-    ValueDict* full_row = validate(row);
-    Handle handle = append(full_row);
+    ValueTuple* full_row = validate(row);
+    Handle handle;
+    try {
+        handle = append(full_row);
+    } catch (...) {
+        delete full_row;
+        throw;
+    }
     delete full_row;
     return handle;
 }
@@ -321,10 +908,13 @@ void HeapTable::del(const Handle handle) {
 	open();
 	BlockID block_id = handle.first;
 	RecordID record_id = handle.second;
-	SlottedPage* block = this->file.get(block_id);
-	block->del(record_id);
-	this->file.put(block);
+	SlottedPage* block = this->file->get(block_id);
+	ToastRefs toasted = this->codec.toasted(block->view(record_id));
+	block->del(record_id);  // the block's zones stay as they were: wider than need be is fine
+	this->file->put(block);
 	delete block;
+	for (auto const& ref: toasted)
+		toast_del(ref.chunk);
 }
 
 // Conceptually, execute: SELECT <handle> FROM <table_name> WHERE 1
@@ -336,30 +926,284 @@ Handles* HeapTable::select() {
 // Conceptually, execute: SELECT <handle> FROM <table_name> WHERE <where>
 // Returns a list of handles for qualifying rows.
 Handles* HeapTable::select(const ValueDict* where) {
-	open();
 	Handles* handles = new Handles();
-	BlockIDs* block_ids = file.block_ids();
-    for (auto const& block_id: *block_ids) {
-    	SlottedPage* block = file.get(block_id);
-    	RecordIDs* record_ids = block->ids();
-    	for (auto const& record_id: *record_ids) {
-			Handle handle(block_id, record_id);
-			if (selected(handle, where))
-    			handles->push_back(handle);
-		}
-    	delete record_ids;
-    	delete block;
-    }
-    delete block_ids;
+	HandleIterator* rows = scan(where);
+	Handle handle;
+	while (rows->next(handle))
+		handles->push_back(handle);
+	delete rows;
 	return handles;
 }
 
+/**
+ * @class HeapTableScan - the qualifying rows of a HeapTable, found a block at a time as they are asked for.
+ * Only the current block is held (pinned), so rows can be deleted as they are handed out.
+ * The where clause is compiled against the table's layout once, and each record is tested where it sits
+ * in the block; only the rows handed out are ever decoded (by whoever projects them).
+ */
+class HeapTableScan : public HandleIterator {
+public:
+	HeapTableScan(HeapTable *table, const ValueDict* where) : table(table), blocks(nullptr),
+			block(nullptr), record_ids(nullptr), where(table->predicate(where)), filter(nullptr), row() {
+		this->filter = table->block_filter(where);
+		this->blocks = table->file->scan();
+		this->blocks->set_filter(this->filter);
+	}
+
+	virtual ~HeapTableScan() {
+		delete this->record_ids;
+		delete this->block;
+		delete this->blocks;
+		delete this->filter;
+		delete this->where;
+	}
+
+	HeapTableScan(const HeapTableScan& other) = delete;
+	HeapTableScan(HeapTableScan&& temp) = delete;
+	HeapTableScan& operator=(const HeapTableScan& other) = delete;
+	HeapTableScan& operator=(HeapTableScan&& temp) = delete;
+
+	virtual bool next(Handle &item) {
+		RecordID record_id;
+		while (true) {
+			if (this->block != nullptr) {
+				while (this->record_ids->next(record_id)) {
+					if (this->table->selected(this->block, record_id, this->where, this->row)) {
+						item = Handle(this->block->get_block_id(), record_id);
+						return true;
+					}
+				}
+				delete this->record_ids;
+				delete this->block;
+				this->record_ids = nullptr;
+			}
+			this->block = this->blocks->next();
+			if (this->block == nullptr)
+				return false;
+			this->record_ids = this->block->scan_ids();
+		}
+	}
+
+protected:
+	HeapTable *table;
+	BlockScan *blocks;
+	SlottedPage *block;           // current block (nullptr before the first and after the last)
+	RecordIDIterator *record_ids; // position within block
+	RowPredicate *where;
+	BlockFilter *filter;          // blocks the where clause can't rule out
+	ValueTuple row;               // for rows that can't be tested in place (reused, to save allocations)
+};
+
+/**
+ * @class HeapTableBatchScan - the qualifying rows of a HeapTable, a ColumnBatch at a time.
+ *
+ * Blocks are taken in order as for HeapTableScan; a block can be left part way through when
+ * a batch fills up, and the next batch carries on from there.
+ */
+class HeapTableBatchScan : public ColumnBatchIterator {
+public:
+	HeapTableBatchScan(HeapTable *table, const ColumnOrdinals* ordinals, const ValueDict* where, uint capacity)
+			: table(table), blocks(nullptr), block(nullptr), record_ids(nullptr), where(table->predicate(where)),
+			  filter(nullptr), ordinals(*ordinals), attributes(), capacity(capacity), row(), values(ordinals->size()) {
+		ColumnAttributes all = table->get_column_attributes();
+		for (auto ordinal: this->ordinals)
+			this->attributes.push_back(all.at(ordinal));
+		this->filter = table->block_filter(where);
+		this->blocks = table->file->scan();
+		this->blocks->set_filter(this->filter);
+	}
+
+	virtual ~HeapTableBatchScan() {
+		delete this->record_ids;
+		delete this->block;
+		delete this->blocks;
+		delete this->filter;
+		delete this->where;
+	}
+
+	HeapTableBatchScan(const HeapTableBatchScan& other) = delete;
+	HeapTableBatchScan(HeapTableBatchScan&& temp) = delete;
+	HeapTableBatchScan& operator=(const HeapTableBatchScan& other) = delete;
+	HeapTableBatchScan& operator=(HeapTableBatchScan&& temp) = delete;
+
+	virtual bool next(ColumnBatch &batch) {
+		batch.reset(this->attributes, this->capacity);
+		RecordID record_id;
+		while (!batch.full()) {
+			if (this->block == nullptr) {
+				this->block = this->blocks->next();
+				if (this->block == nullptr)
+					break;
+				this->record_ids = this->block->scan_ids();
+			}
+			while (!batch.full() && this->record_ids->next(record_id))
+				add(batch, record_id);
+			if (!batch.full()) {
+				delete this->record_ids;
+				delete this->block;
+				this->record_ids = nullptr;
+				this->block = nullptr;
+			}
+		}
+		batch.select_all();
+		return batch.size() > 0;
+	}
+
+protected:
+	HeapTable *table;
+	BlockScan *blocks;
+	SlottedPage *block;           // current block (nullptr between blocks)
+	RecordIDIterator *record_ids; // position within block
+	RowPredicate *where;
+	BlockFilter *filter;          // blocks the where clause can't rule out
+	ColumnOrdinals ordinals;      // table column of each batched column
+	ColumnAttributes attributes;  // of each batched column
+	uint capacity;
+	ValueTuple row;               // for rows that have to be decoded (reused, to save allocations)
+	ValueTuple values;            // the batched columns of such a row
+
+	void add(ColumnBatch &batch, RecordID record_id) {
+		if (!this->table->selected(this->block, record_id, this->where, this->row))
+			return;
+		Handle handle(this->block->get_block_id(), record_id);
+		if (this->table->pax) {
+			if (this->table->codec.append(*static_cast<const PaxPage*>(this->block), record_id, this->ordinals, handle, batch))
+				return;
+		} else if (this->table->codec.append(this->block->view(record_id), this->ordinals, handle, batch)) {
+			return;
+		}
+		this->table->unmarshal(this->block, record_id, this->row, &this->ordinals);
+		for (uint i = 0; i < this->ordinals.size(); i++)
+			this->values[i] = this->row[this->ordinals[i]];
+		batch.append(handle, this->values);
+	}
+};
+
+// Conceptually, execute: SELECT <handle> FROM <table_name> WHERE <where>
+// Returns the qualifying rows one at a time as they are found.
+HandleIterator* HeapTable::scan(const ValueDict* where) {
+	open();
+	return new HeapTableScan(this, where);
+}
+
+ColumnBatchIterator* HeapTable::scan_batches(const ColumnOrdinals* ordinals, const ValueDict* where, uint capacity) {
+	open();
+	return new HeapTableBatchScan(this, ordinals, where, capacity);
+}
+
+// Execute: SELECT <ordinals> FROM <table_name> WHERE <where>
+// Runs of SCAN_CHUNK blocks are taken in turn by up to parallelism threads (this one included);
+// each run's rows are kept apart and the runs are put back together in block order at the end.
+ValueTuples* HeapTable::scan_project(const ValueDict* where, const ColumnOrdinals* ordinals, uint parallelism) {
+	open();
+	if (!this->toast_ready && this->toast->exists())
+		toast_file();  // open it now, rather than have the threads race to
+	RowPredicate* predicate = this->predicate(where);
+	BlockFilter* filter = block_filter(where);  // built here, so the threads only read the zone map
+	BlockID last = this->file->get_last_block_id();
+	uint chunks = (last + SCAN_CHUNK - 1) / SCAN_CHUNK;
+	vector<ValueTuples> results(chunks);
+	atomic<uint> next_chunk(0);
+	exception_ptr error;
+	mutex error_latch;
+	auto work = [&]() {
+		try {
+			for (uint chunk = next_chunk++; chunk < chunks; chunk = next_chunk++) {
+				BlockID first = chunk * SCAN_CHUNK + 1;
+				scan_blocks(first, min(last, first + SCAN_CHUNK - 1), predicate, filter, ordinals, results[chunk]);
+			}
+		} catch (...) {
+			lock_guard<mutex> guard(error_latch);
+			if (!error)
+				error = current_exception();
+			next_chunk = chunks;  // no point in the others carrying on
+		}
+	};
+	vector<thread> workers;
+	for (uint i = 1; i < min(parallelism, chunks); i++) {
+		try {
+			workers.push_back(thread(work));
+		} catch (system_error &e) {
+			break;  // make do with the threads we got
+		}
+	}
+	work();
+	for (auto &worker: workers)
+		worker.join();
+	delete filter;
+	delete predicate;
+
+	size_t n = 0;
+	for (auto const& rows: results)
+		n += rows.size();
+	ValueTuples* ret = new ValueTuples();
+	if (!error)
+		ret->reserve(n);
+	for (auto const& rows: results)
+		for (auto row: rows)
+			if (error)
+				delete row;
+			else
+				ret->push_back(row);
+	if (error) {
+		delete ret;
+		rethrow_exception(error);
+	}
+	return ret;
+}
+
+// Test and project the rows of blocks first through last (passing over those the filter rules out),
+// adding the ones that qualify to rows.
+void HeapTable::scan_blocks(BlockID first, BlockID last, const RowPredicate* where, const BlockFilter* filter,
+							const ColumnOrdinals* ordinals, ValueTuples &rows) {
+	BlockScan blocks(this->file, first, last);
+	blocks.set_filter(filter);
+	ValueTuple row;  // scratch space, reused from record to record
+	SlottedPage *block;
+	while ((block = blocks.next()) != nullptr) {
+		RecordIDIterator *record_ids = block->scan_ids();
+		try {
+			RecordID record_id;
+			while (record_ids->next(record_id)) {
+				if (!selected(block, record_id, where, row))
+					continue;
+				unmarshal(block, record_id, row, ordinals);
+				ValueTuple *result = new ValueTuple();
+				result->reserve(ordinals->size());
+				for (auto ordinal: *ordinals)
+					result->push_back(row[ordinal]);
+				rows.push_back(result);
+			}
+		} catch (...) {
+			delete record_ids;
+			delete block;
+			throw;
+		}
+		delete record_ids;
+		delete block;
+	}
+}
+
 // Refine another selection
 Handles* HeapTable::select(Handles *current_selection, const ValueDict* where) {
     Handles* handles = new Handles();
-    for (auto const& handle: *current_selection)
-        if (selected(handle , where))
+    if (where == nullptr) {
+    	*handles = *current_selection;
+    	return handles;
+    }
+    RowPredicate* predicate = this->predicate(where);
+    BlockFilter* filter = block_filter(where);
+    ValueTuple row;
+    for (auto const& handle: *current_selection) {
+    	if (filter != nullptr && !filter->wanted(handle.first))
+    		continue;
+    	SlottedPage* block = this->file->get(handle.first);
+        if (present(block, handle.second) && selected(block, handle.second, predicate, row))
             handles->push_back(handle);
+        delete block;
+    }
+    delete filter;
+    delete predicate;
     return handles;
 }
 
@@ -369,30 +1213,50 @@ ValueDict* HeapTable::project(Handle handle) {
 }
 
 // Return a sequence of values for handle given by column_names.
+// (Adapter for callers that want a dictionary; plans use the ordinal version below.)
 ValueDict* HeapTable::project(Handle handle, const ColumnNames* column_names) {
+	if (column_names->empty())
+		return project(handle);
+	ColumnOrdinals* ordinals = get_ordinals(*column_names);
+	ValueTuple* row;
+	try {
+		row = project(handle, ordinals);
+	} catch (...) {
+		delete ordinals;
+		throw;
+	}
+	ValueDict* result = new ValueDict();
+	for (uint i = 0; i < ordinals->size(); i++)
+		(*result)[(*column_names)[i]] = (*row)[i];
+	delete row;
+	delete ordinals;
+	return result;
+}
+
+// Return the values for handle at the given column positions.
+ValueTuple* HeapTable::project(Handle handle, const ColumnOrdinals* ordinals) {
 	BlockID block_id = handle.first;
 	RecordID record_id = handle.second;
-    SlottedPage* block = file.get(block_id);
-    Dbt* data = block->get(record_id);
-    ValueDict* row = unmarshal(data);
-    delete data;
+    SlottedPage* block = this->file->get(block_id);
+    if (!present(block, record_id)) {
+    	delete block;
+    	throw DbRelationError("no such row");
+    }
+    ValueTuple row;
+    unmarshal(block, record_id, row, ordinals);
     delete block;
-    if (column_names->empty())
-    	return row;
-    ValueDict* result = new ValueDict();
-    for (auto const& column_name: *column_names) {
-		if (row->find(column_name) == row->end())
-			throw DbRelationError("table does not have column named '" + column_name + "'");
-    	(*result)[column_name] = (*row)[column_name];
-	}
-	delete row;
+    ValueTuple* result = new ValueTuple();
+    result->reserve(ordinals->size());
+    for (auto ordinal: *ordinals)
+    	result->push_back(row.at(ordinal));
     return result;
 }
 
 // Check if the given row is acceptable to insert. Raise ValueError if not.
-// Otherwise return the full row dictionary.
-ValueDict* HeapTable::validate(const ValueDict* row) const {
-    ValueDict* full_row = new ValueDict();
+// Otherwise return the full row, one value per column.
+ValueTuple* HeapTable::validate(const ValueDict* row) const {
+    ValueTuple* full_row = new ValueTuple();
+    full_row->reserve(this->column_names.size());
     for (auto const& column_name: this->column_names) {
     	Value value;
     	ValueDict::const_iterator column = row->find(column_name);
@@ -400,111 +1264,548 @@ ValueDict* HeapTable::validate(const ValueDict* row) const {
     		throw DbRelationError("don't know how to handle NULLs, defaults, etc. yet");
     	else
     		value = column->second;
-    	(*full_row)[column_name] = value;
+    	full_row->push_back(value);
     }
     return full_row;
 }
 
 // Assumes row is fully fleshed-out. Appends a record to the file.
-Handle HeapTable::append(const ValueDict* row) {
-    Dbt* data = marshal(row);
-    SlottedPage* block = this->file.get(this->file.get_last_block_id());
-    RecordID record_id;
+// The record is encoded straight into its slot (or, for a PAX block, which splits it up, encoded and
+// then added); TEXT values too long to keep in the row go to the toast file.
+Handle HeapTable::append(const ValueTuple* row) {
+	const uint toast_limit = this->file->get_block_size() / TOAST_FRACTION;
+	uint size = this->codec.size(*row, toast_limit);
+	if (size > this->file->get_block_size() - 32)  // 32: block and record headers
+		throw DbRelationError("row too big to marshal");
+	Handles chunks;
+	RecordID record_id;
+	SlottedPage* block;
+	try {
+		for (auto column: this->codec.toasting(*row, toast_limit)) {
+			if ((*row)[column].s.length() > UINT32_MAX)
+				throw DbRelationError("text field too long to marshal");
+			chunks.push_back(toast_put((*row)[column].s));
+		}
+		if (this->pax) {
+			string record(size, '\0');
+			this->codec.encode(*row, toast_limit, chunks, &record[0]);
+			Dbt data(&record[0], size);
+			block = room_for(*this->file, &data, record_id);
+		} else {
+			char *bytes;
+			block = room_for(*this->file, size, record_id, &bytes);
+			this->codec.encode(*row, toast_limit, chunks, bytes);
+		}
+	} catch (...) {
+		// no record points at the values already written out of line, so free them
+		for (auto const& chunk: chunks)
+			toast_del(chunk);
+		throw;
+	}
+	this->blooms.add(block->get_block_id(), *row);  // before the block can be written back
+	this->file->put(block);
+	this->zones.add(block->get_block_id(), *row);
+	Handle handle(block->get_block_id(), record_id);
+	delete block;
+	return handle;
+}
+
+// Add a record to the given file (the table's own or its toast file).
+Handle HeapTable::store(HeapFile &into, const Dbt* data) {
+	RecordID record_id;
+	SlottedPage* block = room_for(into, data, record_id);
+	into.put(block);
+	Handle handle(block->get_block_id(), record_id);
+	delete block;
+	return handle;
+}
+
+// Make a record of the given size in the given file, to be filled in at bytes.
+// The record goes into whichever block the free-space map finds room in (not necessarily the last one).
+// The caller puts and deletes the returned block once the record is filled in.
+SlottedPage* HeapTable::room_for(HeapFile &into, uint size, RecordID &record_id, char **bytes) {
+    SlottedPage* block = into.get_with_room(size);
+    try {
+        record_id = block->add(size, bytes);
+    } catch (DbBlockNoRoomError& e) {
+    	// free-space map was out of date; correct it and use a new block
+    	into.put(block);
+    	delete block;
+    	block = into.get_new();
+    	record_id = block->add(size, bytes);
+    }
+    return block;
+}
+
+// Add a record to the given file, in whichever block the free-space map finds room in (as above).
+SlottedPage* HeapTable::room_for(HeapFile &into, const Dbt* data, RecordID &record_id) {
+    SlottedPage* block = into.get_with_room(data->get_size());
     try {
         record_id = block->add(data);
     } catch (DbBlockNoRoomError& e) {
-    	// need a new block
-    	block = this->file.get_new();
+    	into.put(block);
+    	delete block;
+    	block = into.get_new();
     	record_id = block->add(data);
     }
-    this->file.put(block);
-	delete block;
-    delete[] (char*)data->get_data();
-    delete data;
-    return Handle(this->file.get_last_block_id(), record_id);
+    return block;
 }
 
-// return the bits to go into the file
-// caller responsible for freeing the returned Dbt and its enclosed ret->get_data().
-Dbt* HeapTable::marshal(const ValueDict* row) const {
-	char *bytes = new char[DbBlock::BLOCK_SZ]; // more than we need (we insist that one row fits into DbBlock::BLOCK_SZ)
-    uint offset = 0;
-    uint col_num = 0;
-    for (auto const& column_name: this->column_names) {
-    	ColumnAttribute ca = this->column_attributes[col_num++];
-    	ValueDict::const_iterator column = row->find(column_name);
-		Value value = column->second;
-
-		if (ca.get_data_type() == ColumnAttribute::DataType::INT) {
-			if (offset + 4 > DbBlock::BLOCK_SZ - 4)
-				throw DbRelationError("row too big to marshal");
-			*(int32_t*) (bytes + offset) = value.n;
-			offset += sizeof(int32_t);
-		} else if (ca.get_data_type() == ColumnAttribute::DataType::TEXT) {
-			u_long size = value.s.length();
-			if (size > UINT16_MAX)
-				throw DbRelationError("text field too long to marshal");
-			if (offset + 2 + size > DbBlock::BLOCK_SZ)
-				throw DbRelationError("row too big to marshal");
-			*(u16*) (bytes + offset) = size;
-			offset += sizeof(u16);
-			memcpy(bytes+offset, value.s.c_str(), size); // assume ascii for now
-			offset += size;
-        } else if (ca.get_data_type() == ColumnAttribute::DataType::BOOLEAN) {
-            if (offset + 1 > DbBlock::BLOCK_SZ - 1)
-                throw DbRelationError("row too big to marshal");
-            *(uint8_t*) (bytes + offset) = (uint8_t)value.n;
-            offset += sizeof(uint8_t);
-		} else {
-			throw DbRelationError("Only know how to marshal INT, TEXT, and BOOLEAN");
-		}
+// The toast file, opened (or created, the first time a value needs it) on demand.
+HeapFile& HeapTable::toast_file() {
+	if (!this->toast_ready) {
+		if (this->toast->exists())
+			this->toast->open();
+		else
+			this->toast->create();
+		this->toast_ready = true;
+	}
+	return *this->toast;
+}
+
+// Write a long value out as a chain of chunks. Returns the first chunk.
+// The chunks are written last to first so that each one knows its successor.
+Handle HeapTable::toast_put(const string &value) {
+	HeapFile &toast = toast_file();
+	const uint chunk_size = toast.get_block_size() - 32 - TOAST_LINK_SZ;  // 32: block and record headers
+	uint n_chunks = (uint)((value.size() + chunk_size - 1) / chunk_size);
+	char *bytes = new char[TOAST_LINK_SZ + chunk_size];
+	Handle next(0, 0);
+	for (uint i = n_chunks; i-- > 0; ) {
+		uint start = i * chunk_size;
+		uint size = min(chunk_size, (uint)value.size() - start);
+		*(BlockID*)bytes = next.first;
+		*(RecordID*)(bytes + sizeof(BlockID)) = next.second;
+		memcpy(bytes + TOAST_LINK_SZ, value.data() + start, size);
+		Dbt data(bytes, TOAST_LINK_SZ + size);
+		next = store(toast, &data);
 	}
-	char *right_size_bytes = new char[offset];
-	memcpy(right_size_bytes, bytes, offset);
 	delete[] bytes;
-	Dbt *data = new Dbt(right_size_bytes, offset);
-	return data;
+	return next;
 }
 
-ValueDict* HeapTable::unmarshal(Dbt* data) const {
-    ValueDict *row = new ValueDict();
-    Value value;
-    char *bytes = (char*)data->get_data();
-    uint offset = 0;
-    uint col_num = 0;
-    for (auto const& column_name: this->column_names) {
-    	ColumnAttribute ca = this->column_attributes[col_num++];
-		value.data_type = ca.get_data_type();
-    	if (ca.get_data_type() == ColumnAttribute::DataType::INT) {
-    		value.n = *(int32_t*)(bytes + offset);
-    		offset += sizeof(int32_t);
-    	} else if (ca.get_data_type() == ColumnAttribute::DataType::TEXT) {
-    		u16 size = *(u16*)(bytes + offset);
-    		offset += sizeof(u16);
-    		char buffer[DbBlock::BLOCK_SZ];
-    		memcpy(buffer, bytes+offset, size);
-    		buffer[size] = '\0';
-    		value.s = string(buffer);  // assume ascii for now
-            offset += size;
-        } else if (ca.get_data_type() == ColumnAttribute::DataType::BOOLEAN) {
-            value.n = *(uint8_t*)(bytes + offset);
-            offset += sizeof(uint8_t);
-    	} else {
-            throw DbRelationError("Only know how to unmarshal INT, TEXT, and BOOLEAN");
-    	}
-		(*row)[column_name] = value;
-    }
-    return row;
-}
-
-// See if the row at the given handle satisfies the given where clause
-bool HeapTable::selected(Handle handle, const ValueDict* where) {
+// Reassemble a value from its chain of chunks.
+string HeapTable::toast_get(Handle chunk, uint32_t size) {
+	HeapFile &toast = toast_file();
+	string value;
+	value.reserve(size);
+	while (chunk.first != 0) {
+		SlottedPage* block = toast.get(chunk.first);
+		RecordView data = block->view(chunk.second);
+		if (data.is_null()) {
+			delete block;
+			throw DbRelationError("missing toast chunk for " + this->table_name);
+		}
+		value.append(data.get_data() + TOAST_LINK_SZ, data.get_size() - TOAST_LINK_SZ);
+		chunk = Handle(*(BlockID*)data.get_data(), *(RecordID*)(data.get_data() + sizeof(BlockID)));
+		delete block;
+	}
+	return value;
+}
+
+// Free a chain of chunks.
+void HeapTable::toast_del(Handle chunk) {
+	HeapFile &toast = toast_file();
+	while (chunk.first != 0) {
+		SlottedPage* block = toast.get(chunk.first);
+		RecordView data = block->view(chunk.second);
+		Handle next(0, 0);
+		if (!data.is_null())
+			next = Handle(*(BlockID*)data.get_data(), *(RecordID*)(data.get_data() + sizeof(BlockID)));
+		block->del(chunk.second);
+		toast.put(block);
+		delete block;
+		chunk = next;
+	}
+}
+
+// Decode a record straight out of its block (caller keeps the block pinned meanwhile).
+// Columns past the end of the record (added to the table after it was written) get 0 or "".
+// Only the given columns are decoded (all of them if none are given), out-of-line values included;
+// the rest of row is left as it was.
+void HeapTable::unmarshal(RecordView data, ValueTuple &row, const ColumnOrdinals* ordinals) {
+	ToastRefs toasted;
+	this->codec.decode(data, row, &toasted, ordinals);
+	for (auto const& ref: toasted)
+		row[ref.column].s = toast_get(ref.chunk, ref.size);
+}
+
+// Decode a record of a block (as above), straight from its minipages if it is a PAX block.
+void HeapTable::unmarshal(const SlottedPage* block, RecordID record_id, ValueTuple &row, const ColumnOrdinals* ordinals) {
+	if (!this->pax) {
+		unmarshal(block->view(record_id), row, ordinals);
+		return;
+	}
+	ToastRefs toasted;
+	this->codec.decode(*static_cast<const PaxPage*>(block), record_id, row, &toasted, ordinals);
+	for (auto const& ref: toasted)
+		row[ref.column].s = toast_get(ref.chunk, ref.size);
+}
+
+// Compile a where clause against the table's layout (nullptr for no where clause; caller frees).
+RowPredicate* HeapTable::predicate(const ValueDict* where) const {
+	if (where == nullptr)
+		return nullptr;
+	ColumnOrdinals* ordinals = get_ordinals(*where);
+	ValueTuple values;
+	for (auto const& column: *where)
+		values.push_back(column.second);
+	RowPredicate* predicate = new RowPredicate(this->codec, *ordinals, values);
+	delete ordinals;
+	return predicate;
+}
+
+// Which blocks can have rows satisfying a where clause, according to the zone map and the Bloom
+// filters (nullptr if they can't rule any out; caller frees). The zone map is built first if need be.
+BlockFilter* HeapTable::block_filter(const ValueDict* where) {
+	if (where == nullptr)
+		return nullptr;
+	ColumnOrdinals* ordinals = get_ordinals(*where);
+	ValueTuple values;
+	for (auto const& column: *where)
+		values.push_back(column.second);
+	BlockFilter* by_zone = this->zones.filter(*ordinals, values);
+	BlockFilter* by_bloom = this->blooms.filter(*ordinals, values);
+	delete ordinals;
+	if (by_zone != nullptr && !this->zones.is_built()) {
+		try {
+			build_zones();
+		} catch (...) {
+			delete by_zone;
+			delete by_bloom;
+			throw;
+		}
+	}
+	if (by_zone == nullptr)
+		return by_bloom;
+	if (by_bloom == nullptr)
+		return by_zone;
+	return new AllFilters({by_zone, by_bloom});
+}
+
+// Fill in the zone map from the table's records, reading only the summarized columns of each.
+void HeapTable::build_zones() {
+	this->zones.clear(true);
+	const ColumnOrdinals &columns = this->zones.get_columns();
+	BlockScan blocks(this->file);
+	ValueTuple row;
+	SlottedPage *block;
+	while ((block = blocks.next()) != nullptr) {
+		RecordIDIterator *record_ids = block->scan_ids();
+		try {
+			RecordID record_id;
+			while (record_ids->next(record_id)) {
+				unmarshal(block, record_id, row, &columns);  // no TEXT columns, so nothing out of line
+				this->zones.add(block->get_block_id(), row);
+			}
+		} catch (...) {
+			delete record_ids;
+			delete block;
+			this->zones.clear();
+			throw;
+		}
+		delete record_ids;
+		delete block;
+	}
+}
+
+void HeapTable::create_bloom_filters(const ColumnNames &column_names, double fp_rate) {
+	open();
+	ColumnOrdinals* columns = get_ordinals(column_names);
+	// size them for the rows per (non-empty) block so far, or for rows of BLOOM_ROW_SZ if there are none
+	unsigned long rows = 0, blocks = 0;
+	BlockScan* scan = this->file->scan(true);  // just counting, so any order will do
+	SlottedPage* block;
+	while ((block = scan->next()) != nullptr) {
+		RecordIDIterator* record_ids = block->scan_ids();
+		unsigned long before = rows;
+		RecordID record_id;
+		while (record_ids->next(record_id))
+			rows++;
+		if (rows > before)
+			blocks++;
+		delete record_ids;
+		delete block;
+	}
+	delete scan;
+	uint rows_per_block = blocks > 0 ? (uint)((rows + blocks - 1) / blocks) : this->file->get_block_size() / BLOOM_ROW_SZ;
+	try {
+		this->blooms.create(*columns, fp_rate, rows_per_block);
+		build_blooms();
+	} catch (...) {
+		delete columns;
+		if (this->blooms.is_open())
+			this->blooms.drop();
+		throw;
+	}
+	delete columns;
+	this->blooms_ready = true;
+}
+
+void HeapTable::drop_bloom_filters() {
+	open();
+	if (this->blooms.is_open() || this->blooms.exists())
+		this->blooms.drop();
+}
+
+// Open the table's Bloom filters, if it has any, rebuilding them if they didn't keep up with the table.
+void HeapTable::open_blooms() {
+	if (this->blooms.exists()) {
+		this->blooms.open();
+		if (this->blooms.is_behind())
+			build_blooms();
+	}
+	this->blooms_ready = true;
+}
+
+// Fill in the Bloom filters from the table's rows, out-of-line values included, and write them out.
+void HeapTable::build_blooms() {
+	this->blooms.clear();
+	const ColumnOrdinals columns = this->blooms.get_columns();
+	BlockScan blocks(this->file);
+	ValueTuple row;
+	SlottedPage *block;
+	while ((block = blocks.next()) != nullptr) {
+		RecordIDIterator *record_ids = block->scan_ids();
+		try {
+			RecordID record_id;
+			while (record_ids->next(record_id)) {
+				unmarshal(block, record_id, row, &columns);
+				this->blooms.add(block->get_block_id(), row);
+			}
+		} catch (...) {
+			delete record_ids;
+			delete block;
+			throw;
+		}
+		delete record_ids;
+		delete block;
+	}
+	this->blooms.flush();
+}
+
+// See if the record satisfies a where clause, testing its bytes in place.
+// Only if that depends on an out-of-line value is the record decoded, into row (scratch space the
+// caller can reuse from record to record).
+bool HeapTable::selected(RecordView data, const RowPredicate* where, ValueTuple &row) {
 	if (where == nullptr)
 		return true;
-	ValueDict* row = this->project(handle, where);
-	return *row == *where;
+	switch (where->test(data)) {
+		case RowPredicate::NO:
+			return false;
+		case RowPredicate::YES:
+			return true;
+		default:
+			unmarshal(data, row, &where->get_ordinals());
+			return where->test(row);
+	}
+}
+
+// As above, for a record of a block, testing a PAX block's record in its minipages.
+bool HeapTable::selected(const SlottedPage* block, RecordID record_id, const RowPredicate* where, ValueTuple &row) {
+	if (!this->pax)
+		return selected(block->view(record_id), where, row);
+	if (where == nullptr)
+		return true;
+	switch (where->test(*static_cast<const PaxPage*>(block), record_id)) {
+		case RowPredicate::NO:
+			return false;
+		case RowPredicate::YES:
+			return true;
+		default:
+			unmarshal(block, record_id, row, &where->get_ordinals());
+			return where->test(row);
+	}
+}
+
+// Check if a block still has a record.
+bool HeapTable::present(const SlottedPage* block, RecordID record_id) const {
+	if (this->pax)
+		return static_cast<const PaxPage*>(block)->has(record_id);
+	return !block->view(record_id).is_null();
+}
+
+// SlottedPage with slide() as it was before compaction was done in place: the data copied through a
+// VLA, then the headers fixed up from an ids() vector. Only for benchmark_slotted_page(), as the
+// reference the other two are measured against.
+class SlottedPageCopySlide : public SlottedPage {
+public:
+	SlottedPageCopySlide(Dbt &block, BlockID block_id) : SlottedPage(block, block_id, true) {}
+
+protected:
+	virtual void slide(u16 start, u16 end) {
+		int shift = end - start;
+		if (shift == 0)
+			return;
+		void *to = this->address((u16)(this->end_free + 1 + shift));
+		void *from = this->address((u16)(this->end_free + 1));
+		int bytes = start - (this->end_free + 1U);
+		char temp[bytes];
+		memcpy(temp, from, bytes);
+		memcpy(to, temp, bytes);
+		RecordIDs* record_ids = ids();
+		for (auto const& record_id : *record_ids) {
+			u16 size, loc;
+			get_header(size, loc, record_id);
+			if (loc <= start) {
+				loc += shift;
+				put_header(record_id, size, loc);
+			}
+		}
+		delete record_ids;
+		this->end_free += shift;
+		put_header();
+	}
+};
+
+// One round of the benchmark on an empty page: fill it with small records, delete every other one,
+// refill, then delete everything.
+static void churn_slotted_page(SlottedPage &page, Dbt &data, unsigned long &adds, unsigned long &deletes) {
+	try {
+		while (true) {
+			page.add(&data);
+			adds++;
+		}
+	} catch (DbBlockNoRoomError& e) {}
+	RecordIDs* record_ids = page.ids();
+	for (size_t i = 0; i < record_ids->size(); i += 2) {
+		page.del((*record_ids)[i]);
+		deletes++;
+	}
+	delete record_ids;
+	try {
+		while (true) {
+			page.add(&data);
+			adds++;
+		}
+	} catch (DbBlockNoRoomError& e) {}
+	record_ids = page.ids();
+	for (auto const& record_id: *record_ids) {
+		page.del(record_id);
+		deletes++;
+	}
+	delete record_ids;
 }
 
+// Microbenchmark of SlottedPage on a delete-heavy workload (see churn_slotted_page()). Run with the
+// old copying slide() for reference, then with eager and deferred compaction.
+void benchmark_slotted_page() {
+	const int rounds = 20000;
+	const char *modes[] = {"copying slide (before)", "eager compaction", "deferred compaction"};
+	char block[DbBlock::BLOCK_SZ];
+	char record[40];
+	memset(record, 'x', sizeof(record));
+	Dbt data(record, sizeof(record));
+	for (int mode = 0; mode < 3; mode++) {
+		unsigned long deletes = 0, adds = 0;
+		auto start = chrono::steady_clock::now();
+		for (int r = 0; r < rounds; r++) {
+			memset(block, 0, sizeof(block));
+			Dbt dbt(block, sizeof(block));
+			if (mode == 0) {
+				SlottedPageCopySlide page(dbt, 1);
+				churn_slotted_page(page, data, adds, deletes);
+			} else {
+				SlottedPage page(dbt, 1, true, nullptr, mode == 2);
+				churn_slotted_page(page, data, adds, deletes);
+			}
+		}
+		double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << "slotted page, " << modes[mode] << ": "
+			 << deletes << " deletes, " << adds << " adds in " << secs << "s ("
+			 << (int)(secs * 1e9 / deletes) << " ns per delete)" << endl;
+	}
+}
+
+// Benchmark of the two HeapFile backends (and of PAX blocks): insert rows into a table, then scan and project them all.
+void benchmark_heap_table() {
+	const int rows = 100000;
+	ColumnNames column_names;
+	column_names.push_back("a");
+	column_names.push_back("b");
+	ColumnAttributes column_attributes;
+	column_attributes.push_back(ColumnAttribute(ColumnAttribute::INT));
+	column_attributes.push_back(ColumnAttribute(ColumnAttribute::TEXT));
+	struct Setup {
+		HeapTable::Storage storage;
+		HeapTable::Layout layout;
+		const char *name;
+	};
+	Setup setups[] = {{HeapTable::BERKELEY_DB, HeapTable::SLOTTED, "berkeley db"},
+					  {HeapTable::MMAP, HeapTable::SLOTTED, "mmap"},
+					  {HeapTable::BERKELEY_DB, HeapTable::PAX, "berkeley db, pax pages"}};
+	for (auto const& setup: setups) {
+		HeapTable table("_bench_heap", column_names, column_attributes, DbBlock::BLOCK_SZ, setup.storage, setup.layout);
+		table.create();
+		ValueDict row;
+		row["b"] = Value("the quick brown fox jumps over the lazy dog");
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < rows; i++) {
+			row["a"] = Value(i);
+			table.insert(&row);
+		}
+		double insert_secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		start = chrono::steady_clock::now();
+		long sum = 0;
+		Handles* handles = table.select();
+		for (auto const& handle: *handles) {
+			ValueDict* result = table.project(handle);
+			sum += (*result)["a"].n;
+			delete result;
+		}
+		delete handles;
+		double scan_secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << "heap table, " << setup.name << ": "
+			 << rows << " inserts in " << insert_secs << "s (" << (int)(insert_secs * 1e9 / rows) << " ns per row), scan in "
+			 << scan_secs << "s (" << (int)(scan_secs * 1e9 / rows) << " ns per row)" << (sum < 0 ? "!" : "") << endl;
+
+		// scan_project split across threads (what `set parallelism N` gives a SELECT)
+		ColumnOrdinals* ordinals = table.get_ordinals(column_names);
+		for (uint threads = 1; threads <= 4; threads *= 2) {
+			start = chrono::steady_clock::now();
+			ValueTuples* projected = table.scan_project(nullptr, ordinals, threads);
+			double project_secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			for (auto tuple: *projected)
+				delete tuple;
+			delete projected;
+			cout << "    scan_project, " << threads << (threads == 1 ? " thread: " : " threads: ") << project_secs << "s ("
+				 << (int)(project_secs * 1e9 / rows) << " ns per row)" << endl;
+		}
+		delete ordinals;
+		table.drop();
+	}
+}
+
+// A table that can't find room for its records (its toast file, which goes through the other room_for, can).
+class HeapTableNoRoom : public HeapTable {
+public:
+	HeapTableNoRoom(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes)
+			: HeapTable(table_name, column_names, column_attributes), toasted(0) {}
+	uint toasted;  // toast chunks there were when room was asked for
+
+	// toast chunks there are now
+	uint toast_chunks() {
+		uint n = 0;
+		HeapFile &toast = toast_file();
+		for (BlockID block_id = 1; block_id <= toast.get_last_block_id(); block_id++) {
+			SlottedPage* block = toast.get(block_id);
+			RecordIDs* record_ids = block->ids();
+			n += (uint)record_ids->size();
+			delete record_ids;
+			delete block;
+		}
+		return n;
+	}
+
+protected:
+	using HeapTable::room_for;
+	virtual SlottedPage* room_for(HeapFile &, uint, RecordID &, char **) {
+		this->toasted = toast_chunks();
+		throw DbRelationError("no room");
+	}
+};
+
 void test_set_row(ValueDict &row, int a, string b) {
 	row["a"] = Value(a);
 	row["b"] = Value(b);
@@ -519,10 +1820,12 @@ bool test_compare(DbRelation &table, Handle handle, int a, string b) {
 		return false;
 	}
 	value = (*result)["b"];
-	delete result;
-    if (value.s != b)
+    if (value.s != b) {
+		delete result;
         return false;
+	}
     value = (*result)["c"];
+	delete result;
     if (value.n != (a%2 == 0))
         return false;
     return true;
@@ -588,8 +1891,611 @@ bool test_heap_storage() {
         if (!test_compare(table, handle, i++, b))
             return false;
     cout << "del ok" << endl;
- 
+
+    Handle first_handle = (*handles)[0];
+    table.del(first_handle);
+    test_set_row(row, -1, b);
+    if (table.insert(&row) != first_handle)
+        return false;
+    cout << "free space and record id reuse ok" << endl;
+
+    string huge_b(3 * DbBlock::BLOCK_SZ + 17, 'y');  // goes to the toast file
+    test_set_row(row, 7, huge_b);
+    Handle huge_handle = table.insert(&row);
+    if (!test_compare(table, huge_handle, 7, huge_b))
+        return false;
+    ColumnNames just_a;
+    just_a.push_back("a");
+    ValueDict* a_only = table.project(huge_handle, &just_a);
+    bool a_ok = a_only->size() == 1 && (*a_only)["a"].n == 7;
+    delete a_only;
+    if (!a_ok)
+        return false;
+    ValueDict huge_where;
+    huge_where["b"] = Value(huge_b);
+    Handles* huge_found = table.select(&huge_where);  // has to look at the toast file to tell
+    huge_where["b"].s.back() = 'x';
+    Handles* not_found = table.select(&huge_where);
+    bool where_ok = huge_found->size() == 1 && huge_found->front() == huge_handle && not_found->empty();
+    delete huge_found;
+    delete not_found;
+    if (!where_ok)
+        return false;
+    table.del(huge_handle);
+    HeapTableNoRoom no_room("_test_no_room_cpp", column_names, column_attributes);
+    no_room.create();
+    try {
+        no_room.insert(&row);
+        return false;
+    } catch (DbRelationError &e) {}
+    bool freed = no_room.toasted > 1 && no_room.toast_chunks() == 0;  // huge_b takes several chunks
+    no_room.drop();
+    if (!freed)
+        return false;
+    cout << "toast ok" << endl;
+
+    BufferPool &pool = BufferPool::shared();
+    if (pool.get_hits() == 0)
+        return false;
+    cout << pool << endl;
+
     table.drop();
 	delete handles;
+
+    HeapTable big_table("_test_page_size_cpp", column_names, column_attributes, 16 * DbBlock::BLOCK_SZ);
+    big_table.create();
+    string long_b(2 * DbBlock::BLOCK_SZ, 'x');  // too big for a default block, but kept inline in this one
+    test_set_row(row, 5, long_b);
+    Handle big_handle = big_table.insert(&row);
+    big_table.close();
+    HeapTable reopened("_test_page_size_cpp", column_names, column_attributes);  // block size comes from the file
+    reopened.open();
+    if (!test_compare(reopened, big_handle, 5, long_b))
+        return false;
+    reopened.drop();
+
+    char *max_image = new char[DbBlock::MAX_BLOCK_SZ];
+    Dbt max_block(max_image, DbBlock::MAX_BLOCK_SZ);
+    SlottedPage max_page(max_block, 1, true);
+    uint max_room = max_page.free_space();  // for the record alone; its slot is already taken off
+    bool max_ok = max_room == DbBlock::MAX_BLOCK_SZ - 1 - 8 - 4;
+    for (uint size = max_room + 1; size <= UINT16_MAX + 1U; size++) {
+        char *bytes;
+        try {
+            max_page.add(size, &bytes);  // sizes whose slot would wrap past 16 bits included
+            max_ok = false;
+        } catch (DbBlockNoRoomError &e) {
+        }
+    }
+    max_ok = max_ok && max_page.free_space() == max_room;
+    char *max_bytes;
+    RecordID max_id = max_page.add(max_room, &max_bytes);
+    memset(max_bytes, 'm', max_room);
+    RecordView max_view = max_page.view(max_id);
+    max_ok = max_ok && max_view.get_size() == max_room && max_view.get_data()[max_room - 1] == 'm' &&
+             max_page.free_space() == 0;
+    delete[] max_image;
+    if (!max_ok)
+        return false;
+    cout << "page size ok" << endl;
+
+    HeapTable mapped("_test_mmap_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, HeapTable::MMAP);
+    mapped.create();
+    Handles mapped_handles;
+    for (i = 0; i < 1000; i++) {
+        test_set_row(row, i, b);
+        mapped_handles.push_back(mapped.insert(&row));
+    }
+    test_set_row(row, 8, huge_b);
+    Handle mapped_huge = mapped.insert(&row);
+    mapped.close();
+    HeapTable remapped("_test_mmap_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, HeapTable::MMAP);
+    remapped.open();
+    handles = remapped.select();
+    bool mapped_ok = handles->size() == 1001;
+    delete handles;
+    if (!mapped_ok || !test_compare(remapped, mapped_huge, 8, huge_b))
+        return false;
+    for (i = 0; i < 1000; i++)
+        if (!test_compare(remapped, mapped_handles[i], i, b))
+            return false;
+    remapped.drop();
+    cout << "mmap ok" << endl;
+
+    BufferPool small_pool(8);  // fewer frames than blocks, so the scan really reads ahead
+    HeapFile scanned("_test_scan_cpp", DbBlock::BLOCK_SZ, small_pool);
+    scanned.create();
+    for (BlockID block_id = 2; block_id <= 40; block_id++) {
+        SlottedPage* page = scanned.get_new();
+        Dbt id_data(&block_id, sizeof(block_id));
+        page->add(&id_data);
+        scanned.put(page);
+        delete page;
+    }
+    scanned.close();
+    scanned.open();
+    BlockScan* scan = scanned.scan();
+    BlockID expected = 1;
+    bool scan_ok = true;
+    SlottedPage* page;
+    while ((page = scan->next()) != nullptr) {
+        if (page->get_block_id() != expected) {
+            scan_ok = false;
+        } else if (expected > 1) {
+            Dbt* got = page->get(1);
+            scan_ok = scan_ok && *(BlockID*)got->get_data() == expected;
+            delete got;
+        }
+        expected++;
+        delete page;
+    }
+    delete scan;
+    if (!scan_ok || expected != 41) {
+        scanned.drop();
+        return false;
+    }
+    cout << "scan ok" << endl;
+
+    // a second shared scan joins the first at block 10 and goes round to blocks 1-9 at the end;
+    // one that isn't shared starts from block 1 all the same
+    BlockScan* leader = scanned.scan(true);
+    for (BlockID block_id = 1; block_id <= 10; block_id++)
+        delete leader->next();
+    BlockScan* apart = scanned.scan();
+    for (BlockID block_id = 1; block_id <= 40; block_id++) {
+        page = apart->next();
+        scan_ok = scan_ok && page != nullptr && page->get_block_id() == block_id;
+        delete page;
+    }
+    scan_ok = scan_ok && apart->next() == nullptr;
+    delete apart;
+    BlockScan* follower = scanned.scan(true);
+    BlockIDs followed;
+    while ((page = follower->next()) != nullptr) {
+        followed.push_back(page->get_block_id());
+        delete page;
+        if ((page = leader->next()) != nullptr) {
+            scan_ok = scan_ok && page->get_block_id() == followed.back() + 1;
+            delete page;
+        }
+    }
+    delete follower;
+    delete leader;
+    scanned.drop();
+    if (!scan_ok || followed.size() != 40 || followed.front() != 10 || followed[30] != 40 || followed[31] != 1
+        || followed.back() != 9)
+        return false;
+    cout << "shared scan ok" << endl;
+
+    HeapFile extended("_test_extent_cpp");
+    extended.set_extent_size(8);
+    extended.create();  // block 1, with 2-8 in reserve
+    for (int n = 0; n < 3; n++)
+        delete extended.get_new();
+    extended.close();
+    extended.open();
+    SlottedPage* from_reserve = extended.get_new();  // the reserve outlives the close
+    bool extent_ok = extended.get_last_block_id() == 5 && from_reserve->get_block_id() == 5;
+    delete from_reserve;
+    for (int n = 0; n < 4; n++)
+        delete extended.get_new();
+    extent_ok = extent_ok && extended.get_last_block_id() == 9;
+    extended.drop();
+    if (!extent_ok)
+        return false;
+    cout << "extents ok" << endl;
+
+    HeapFile deferred("_test_deferred_cpp");
+    deferred.set_defer_compaction(true);
+    deferred.create();
+    deferred.close();
+    HeapFile deferred_again("_test_deferred_cpp");  // the option comes from the file
+    deferred_again.open();
+    bool deferred_ok = deferred_again.get_defer_compaction() && !HeapFile("_test_other_cpp").get_defer_compaction();
+    SlottedPage* deferred_page = deferred_again.get(1);
+    char record_bytes[40];
+    Dbt record_data(record_bytes, sizeof(record_bytes));
+    vector<RecordID> filled;
+    try {
+        for (char c = 0; ; c++) {
+            memset(record_bytes, 'a' + c % 26, sizeof(record_bytes));
+            filled.push_back(deferred_page->add(&record_data));
+        }
+    } catch (DbBlockNoRoomError &e) {
+    }
+    const char *kept_at = deferred_page->view(filled[1]).get_data();
+    for (size_t i = 0; i < filled.size(); i += 2)
+        deferred_page->del(filled[i]);
+    deferred_ok = deferred_ok && deferred_page->view(filled[1]).get_data() == kept_at;  // nothing slid yet
+    uint dead_room = deferred_page->free_space();  // counts the dead space not yet squeezed out
+    deferred_ok = deferred_ok && dead_room >= sizeof(record_bytes) * (filled.size() / 2);
+    string big_record(dead_room, 'z');  // only fits once the page is compacted
+    Dbt big_data((void*)big_record.data(), dead_room);
+    RecordID big_id = deferred_page->add(&big_data);
+    deferred_ok = deferred_ok && deferred_page->view(big_id).get_size() == dead_room;
+    for (size_t i = 1; i < filled.size(); i += 2) {
+        RecordView kept = deferred_page->view(filled[i]);
+        deferred_ok = deferred_ok && kept.get_size() == sizeof(record_bytes) && kept.get_data()[0] == 'a' + (char)(i % 26);
+    }
+    delete deferred_page;
+    deferred_again.drop();
+    if (!deferred_ok)
+        return false;
+    cout << "deferred compaction ok" << endl;
+
+    BufferPool behind_pool(16);
+    HeapFile behind("_test_write_behind_cpp", DbBlock::BLOCK_SZ, behind_pool);
+    behind.create();
+    char word[] = "written behind";
+    Dbt word_data(word, sizeof(word));
+    SlottedPage* behind_page = behind.get_new();
+    RecordID word_id = behind_page->add(&word_data);
+    behind.put(behind_page);  // only marks the frame dirty
+    delete behind_page;
+    behind_pool.start_flusher(1);
+    for (int waits = 0; waits < 2000 && behind_pool.get_writes() == 0; waits++)
+        this_thread::sleep_for(chrono::milliseconds(1));
+    behind_pool.stop_flusher();
+    bool behind_ok = behind_pool.get_writes() > 0;
+    behind.close();
+    behind.open();
+    behind_page = behind.get(2);
+    Dbt* word_read = behind_page->get(word_id);
+    behind_ok = behind_ok && strcmp((char*)word_read->get_data(), word) == 0;
+    delete word_read;
+    delete behind_page;
+    behind.drop();
+    if (!behind_ok)
+        return false;
+    cout << "write-behind ok" << endl;
+
+    BufferPool names_pool(4);
+    HeapFile first("_test_pool_names_cpp", DbBlock::BLOCK_SZ, names_pool);
+    first.create();
+    first.flush();  // so second finds the block count in the metadata page
+    HeapFile second("_test_pool_names_cpp", DbBlock::BLOCK_SZ, names_pool);
+    second.open();
+    SlottedPage* first_page = first.get(1);
+    RecordID shared_id = first_page->add(&word_data);
+    first.put(first_page);  // only marks the frame dirty, so second has to find the same frame
+    delete first_page;
+    SlottedPage* second_page = second.get(1);
+    Dbt* shared_read = second_page->get(shared_id);
+    bool names_ok = shared_read != nullptr && strcmp((char*)shared_read->get_data(), word) == 0;
+    delete shared_read;
+    delete second_page;
+    second.close();
+    first.close();
+    first.open();
+    names_pool.reset_stats();
+    names_ok = names_ok && first.read_ahead(1, 1) == 1 && names_pool.get_hits() == 0 && names_pool.get_misses() == 0;
+    delete first.get(1);  // read ahead, so a hit
+    names_ok = names_ok && names_pool.get_hits() == 1 && names_pool.get_misses() == 0;
+    first.drop();
+    if (!names_ok)
+        return false;
+    cout << "buffer pool ok" << endl;
+
+    HeapTable streamed("_test_stream_cpp", column_names, column_attributes);
+    streamed.create();
+    for (i = 0; i < 1000; i++) {
+        test_set_row(row, i, i%2 == 0 ? "even" : "odd");
+        streamed.insert(&row);
+    }
+    ValueDict even;
+    even["b"] = Value("even");
+    HandleIterator* rows = streamed.scan(&even);
+    Handle handle;
+    int deleted = 0;
+    bool nested_ok = false;
+    while (rows->next(handle)) {
+        streamed.del(handle);  // deleting the row just handed out doesn't upset the scan
+        deleted++;
+        if (deleted == 250) {
+            // a scan started while another is part way through the file still goes in block order
+            Handles* during = streamed.select();
+            nested_ok = handle.first > 1 && !during->empty() && during->front().first == 1 &&
+                        is_sorted(during->begin(), during->end());
+            delete during;
+        }
+    }
+    delete rows;
+    handles = streamed.select();
+    bool streamed_ok = nested_ok && deleted == 500 && handles->size() == 500;
+    i = 1;
+    for (auto const& left: *handles) {
+        if (!test_compare(streamed, left, i, "odd"))
+            streamed_ok = false;
+        i += 2;
+    }
+    ColumnNames b_a;
+    b_a.push_back("b");
+    b_a.push_back("a");
+    ColumnOrdinals* ordinals = streamed.get_ordinals(b_a);
+    ValueTuple* tuple = streamed.project(handles->front(), ordinals);
+    if (*ordinals != ColumnOrdinals({1, 0}) || tuple->size() != 2 || (*tuple)[0] != Value("odd") || (*tuple)[1] != Value(1))
+        streamed_ok = false;
+    delete tuple;
+    delete ordinals;
+    ValueDict three;
+    three["a"] = Value(3);
+    Handles* refined = streamed.select(handles, &three);
+    if (refined->size() != 1 || (*refined)[0] != (*handles)[1])
+        streamed_ok = false;
+    delete refined;
+    delete handles;
+    streamed.drop();
+    if (!streamed_ok)
+        return false;
+    cout << "streaming scan ok" << endl;
+
+    // rows big enough for a few to a block, so the table spans several of scan_project's runs
+    HeapTable parallel("_test_parallel_cpp", column_names, column_attributes);
+    parallel.create();
+    string filler(900, 'p');
+    for (i = 0; i < 1200; i++) {
+        test_set_row(row, i, i%3 == 0 ? "three" + filler : filler);
+        parallel.insert(&row);
+    }
+    ordinals = parallel.get_ordinals(just_a);
+    ValueDict threes;
+    threes["b"] = Value("three" + filler);
+    bool parallel_ok = true;
+    for (uint threads = 1; threads <= 4; threads += 3) {
+        ValueTuples* all = parallel.scan_project(nullptr, ordinals, threads);
+        ValueTuples* some = parallel.scan_project(&threes, ordinals, threads);
+        if (all->size() != 1200 || some->size() != 400)
+            parallel_ok = false;
+        for (i = 0; parallel_ok && i < 1200; i++)  // in block order, which is insertion order here
+            if ((*(*all)[i])[0] != Value(i) || (i < 400 && (*(*some)[i])[0] != Value(3 * i)))
+                parallel_ok = false;
+        for (auto tuple: *all)
+            delete tuple;
+        for (auto tuple: *some)
+            delete tuple;
+        delete all;
+        delete some;
+    }
+    delete ordinals;
+    parallel.drop();
+    if (!parallel_ok)
+        return false;
+    cout << "parallel scan ok" << endl;
+
+    HeapTable batched("_test_batch_cpp", column_names, column_attributes);
+    batched.create();
+    for (i = 0; i < 2500; i++) {
+        test_set_row(row, i, i == 2000 ? huge_b : string(i % 5, 'b'));
+        batched.insert(&row);
+    }
+    ColumnOrdinals b_then_a({1, 0});
+    ColumnBatchIterator* batches = batched.scan_batches(&b_then_a);
+    ColumnBatch batch;
+    vector<uint> batch_sizes;
+    bool batched_ok = true;
+    i = 0;
+    while (batches->next(batch)) {
+        batch_sizes.push_back(batch.size());
+        const ColumnBatch::Column &b = batch.column(0), &a = batch.column(1);
+        if (batch.column_count() != 2 || b.data_type != ColumnAttribute::TEXT || a.data_type != ColumnAttribute::INT
+            || batch.get_selection().size() != batch.size() || batch.get_selection().back() != batch.size() - 1)
+            batched_ok = false;
+        for (uint r = 0; batched_ok && r < batch.size(); r++, i++)
+            if (a.ints[r] != i || batch.get(0, r) != Value(i == 2000 ? huge_b : string(i % 5, 'b'))
+                || b.offsets[r + 1] - b.offsets[r] != (i == 2000 ? huge_b.length() : (uint)(i % 5)))
+                batched_ok = false;
+    }
+    delete batches;
+    if (batch_sizes != vector<uint>({1024, 1024, 452}))
+        batched_ok = false;
+    ValueDict fours;
+    fours["b"] = Value("bbbb");
+    handles = batched.select(&fours);
+    batches = batched.scan_batches(&b_then_a, &fours, 100);
+    i = 0;
+    while (batches->next(batch))
+        for (auto r: batch.get_selection()) {
+            if (i >= 500 || batch.column(1).ints[r] != 5 * i + 4 || batch.get_handles()[r] != (*handles)[i])
+                batched_ok = false;
+            i++;
+        }
+    delete batches;
+    delete handles;
+    if (i != 500)
+        batched_ok = false;
+    batched.drop();
+    if (!batched_ok)
+        return false;
+    cout << "batch scan ok" << endl;
+
+    // a = i in insertion order, so the zone map rules out all but one block for a = <value>
+    HeapTable zoned("_test_zone_cpp", column_names, column_attributes);
+    zoned.create();
+    for (i = 0; i < 3000; i++) {
+        test_set_row(row, i, string(40, 'z'));
+        zoned.insert(&row);
+    }
+    bool zoned_ok = true;
+    ValueDict wanted;
+    wanted["a"] = Value(2500);
+    unsigned long read = BlockScan::get_blocks_read(), skipped = BlockScan::get_blocks_skipped();
+    handles = zoned.select(&wanted);
+    zoned_ok = zoned_ok && handles->size() == 1 && test_compare(zoned, handles->front(), 2500, string(40, 'z'));
+    BlockID last = handles->front().first;
+    delete handles;
+    if (BlockScan::get_blocks_read() - read != 1 || BlockScan::get_blocks_skipped() - skipped < 10)
+        zoned_ok = false;
+    wanted["a"] = Value(5);
+    handles = zoned.select(&wanted);  // delete a = 5, then put a = 9999 in its place in the first block
+    zoned_ok = zoned_ok && handles->size() == 1 && handles->front().first == 1;
+    zoned.del(handles->front());
+    delete handles;
+    handles = zoned.select(&wanted);
+    zoned_ok = zoned_ok && handles->empty();
+    delete handles;
+    test_set_row(row, 9999, "z");
+    Handle moved = zoned.insert(&row);
+    wanted["a"] = Value(9999);
+    handles = zoned.select(&wanted);
+    zoned_ok = zoned_ok && moved.first == 1 && handles->size() == 1 && handles->front() == moved;
+    delete handles;
+    ColumnOrdinals just_b({1});
+    for (uint reopened = 0; reopened < 2; reopened++) {
+        wanted["a"] = Value(2500);
+        ValueTuples* rows = zoned.scan_project(&wanted, &just_b, 2);
+        zoned_ok = zoned_ok && rows->size() == 1 && (*rows)[0]->at(0) == Value(string(40, 'z'));
+        for (auto r: *rows)
+            delete r;
+        delete rows;
+        wanted["b"] = Value(string(40, 'z'));
+        handles = zoned.select(&wanted);
+        zoned_ok = zoned_ok && handles->size() == 1 && handles->front().first == last;
+        delete handles;
+        wanted["a"] = Value(-1);  // in no block
+        read = BlockScan::get_blocks_read();
+        skipped = BlockScan::get_blocks_skipped();
+        handles = zoned.select(&wanted);
+        zoned_ok = zoned_ok && handles->empty() && BlockScan::get_blocks_read() == read
+                   && BlockScan::get_blocks_skipped() - skipped >= 10;
+        delete handles;
+        wanted.erase("b");
+        zoned.close();  // the map is rebuilt from the blocks on the next scan
+    }
+    zoned.drop();
+    if (!zoned_ok)
+        return false;
+    cout << "zone map ok" << endl;
+
+    HeapTable bloomed("_test_bloom_cpp", column_names, column_attributes);
+    bloomed.create();
+    for (i = 0; i < 3000; i++) {
+        test_set_row(row, i % 7, "value " + to_string(i) + string(30, '.'));
+        bloomed.insert(&row);
+    }
+    test_set_row(row, 1, huge_b);  // out of line
+    Handle huge = bloomed.insert(&row);
+    bool bloomed_ok = true;
+    try {
+        bloomed.create_bloom_filters(ColumnNames({"a"}));
+        bloomed_ok = false;
+    } catch (DbRelationError &e) {}  // only TEXT columns
+    bloomed.create_bloom_filters(ColumnNames({"b"}), 0.001);
+    test_set_row(row, 1, "added");
+    Handle added = bloomed.insert(&row);
+    for (uint reopened = 0; reopened < 2; reopened++) {
+        ValueDict by_b;
+        by_b["b"] = Value("value 2500" + string(30, '.'));
+        read = BlockScan::get_blocks_read();
+        handles = bloomed.select(&by_b);
+        bloomed_ok = bloomed_ok && handles->size() == 1 && test_compare(bloomed, handles->front(), 2500 % 7, by_b["b"].s);
+        delete handles;
+        bloomed_ok = bloomed_ok && BlockScan::get_blocks_read() - read <= 2;
+        by_b["b"] = Value(huge_b);
+        handles = bloomed.select(&by_b);
+        bloomed_ok = bloomed_ok && handles->size() == 1 && handles->front() == huge;
+        delete handles;
+        by_b["b"] = Value("added");
+        by_b["a"] = Value(1);
+        handles = bloomed.select(&by_b);
+        bloomed_ok = bloomed_ok && handles->size() == 1 && handles->front() == added;
+        delete handles;
+        by_b["b"] = Value("nowhere");
+        read = BlockScan::get_blocks_read();
+        handles = bloomed.select(&by_b);
+        bloomed_ok = bloomed_ok && handles->empty() && BlockScan::get_blocks_read() - read <= 1;
+        delete handles;
+        bloomed.close();  // the filters are written out and read back in on the next open
+        bloomed.open();
+        bloomed_ok = bloomed_ok && bloomed.get_bloom_columns() == ColumnOrdinals({1});
+    }
+    bloomed.drop_bloom_filters();
+    ValueDict by_b;
+    by_b["b"] = Value("nowhere");
+    read = BlockScan::get_blocks_read();
+    handles = bloomed.select(&by_b);
+    bloomed_ok = bloomed_ok && handles->empty() && BlockScan::get_blocks_read() - read > 10;
+    delete handles;
+    bloomed.drop();
+    if (!bloomed_ok)
+        return false;
+    cout << "bloom filtered table ok" << endl;
+
+    // a PAX table does all a slotted one does, and keeps its layout across a reopen
+    HeapTable pax("_test_pax_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, HeapTable::BERKELEY_DB,
+                  HeapTable::PAX);
+    pax.create();
+    Handles pax_handles;
+    for (i = 0; i < 1000; i++) {
+        test_set_row(row, i, "value " + to_string(i % 50) + string(i % 30, 'x'));
+        pax_handles.push_back(pax.insert(&row));
+    }
+    test_set_row(row, 9, huge_b);
+    Handle pax_huge = pax.insert(&row);
+    bool pax_ok = pax_handles.back().first > 1;
+    HeapTable pax_reopened("_test_pax_cpp", column_names, column_attributes);  // the layout comes from the file
+    for (uint reopened = 0; reopened < 2; reopened++) {
+        HeapTable &t = reopened == 0 ? pax : pax_reopened;
+        if (reopened == 1)
+            t.open();
+        handles = t.select();
+        pax_ok = pax_ok && handles->size() == 1001 - 334 * reopened;
+        delete handles;
+        pax_ok = pax_ok && test_compare(t, pax_huge, 9, huge_b);
+        for (i = reopened; i < 1000; i += 3)
+            pax_ok = pax_ok && test_compare(t, pax_handles[i], i, "value " + to_string(i % 50) + string(i % 30, 'x'));
+        ValueDict pax_where;
+        pax_where["b"] = Value(huge_b);
+        handles = t.select(&pax_where);
+        pax_ok = pax_ok && handles->size() == 1 && handles->front() == pax_huge;
+        delete handles;
+        pax_where["b"] = Value("value 7" + string(7, 'x'));  // rows 7, 157, ..., 907: all odd, none deleted
+        handles = t.select(&pax_where);
+        pax_ok = pax_ok && handles->size() == 7;
+        pax_where["c"] = Value(false);
+        pax_where["c"].data_type = ColumnAttribute::BOOLEAN;
+        Handles* refined = t.select(handles, &pax_where);
+        pax_ok = pax_ok && refined->size() == 7;
+        delete refined;
+        pax_where["c"].n = 1;
+        refined = t.select(handles, &pax_where);
+        pax_ok = pax_ok && refined->empty();
+        delete refined;
+        delete handles;
+        pax_where.erase("b");
+        ColumnOrdinals pax_ordinals({0, 1});
+        ValueTuples* evens = t.scan_project(&pax_where, &pax_ordinals, 2);
+        pax_ok = pax_ok && evens->size() == 500U - 167 * reopened && (*(*evens)[0])[0].n == (int)(2 * reopened);
+        for (auto projected: *evens)
+            delete projected;
+        delete evens;
+        ColumnBatchIterator* batches = t.scan_batches(&pax_ordinals);
+        ColumnBatch batch;
+        uint batched = 0;
+        bool batch_ok = true;
+        while (batches->next(batch)) {
+            for (uint r = 0; r < batch.size(); r++) {
+                int32_t a = (int32_t)batch.column(0).ints[r];
+                batch_ok = batch_ok && (a == 9 || batch.get(1, r).s == "value " + to_string(a % 50) + string(a % 30, 'x'));
+            }
+            batched += batch.size();
+        }
+        delete batches;
+        pax_ok = pax_ok && batch_ok && batched == 1001 - 334 * reopened;
+        if (reopened == 0) {
+            for (i = 0; i < 1000; i += 3)
+                pax.del(pax_handles[i]);
+            test_set_row(row, 2000, "refill");
+            pax_ok = pax_ok && pax.insert(&row) == pax_handles[0];  // the first deleted id is reused
+            pax.del(pax_handles[0]);
+            pax.close();
+        } else {
+            t.close();
+        }
+    }
+    pax.open();
+    pax.drop();
+    if (!pax_ok)
+        return false;
+    cout << "pax table ok" << endl;
     return true;
 }
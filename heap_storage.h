@@ -9,8 +9,17 @@
  */
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
 #include "db_cxx.h"
 #include "storage_engine.h"
+#include "buffer_pool.h"
+#include "free_space_map.h"
+#include "row_codec.h"
+#include "zone_map.h"
+#include "bloom_filters.h"
 
 /**
  * @class SlottedPage - heap file implementation of DbBlock.
@@ -18,57 +27,138 @@
  *      Manage a database block that contains several records.
         Modeled after slotted-page from Database Systems Concepts, 6ed, Figure 10-9.
 
-        Record id are handed out sequentially starting with 1 as records are added with add().
+        Record id are handed out sequentially starting with 1 as records are added with add(),
+        except that add() first reuses the lowest id whose record has been deleted.
         Each record has a header which is a fixed offset from the beginning of the block:
-            Bytes 0x00 - Ox01: number of records
+            Bytes 0x00 - Ox01: number of records (slots, including deleted ones)
             Bytes 0x02 - 0x03: offset to end of free space
-            Bytes 0x04 - 0x05: size of record 1
-            Bytes 0x06 - 0x07: offset to record 1
+            Bytes 0x04 - 0x05: lowest deleted record id (0 if none)
+            Bytes 0x06 - 0x07: FORMAT
+            Bytes 0x08 - 0x09: size of record 1
+            Bytes 0x0A - 0x0B: offset to record 1
             etc.
+        A deleted record's header is (0, 0); trailing deleted headers are dropped from the count.
+        Blocks written before the free-slot hint existed have no bytes 0x04 - 0x07 (record 1's
+        header starts at 0x04); they are recognized by the missing FORMAT and still readable.
+
+        The block may be any size up to DbBlock::MAX_BLOCK_SZ. Offsets are 16 bits, so a 64kB
+        block leaves its very last byte unused (block_end) to keep every offset below 0x10000.
+
+        Deleting (or shrinking) a record normally slides the data below it over the freed space right
+        away. With defer_compaction (which the block's HeapFile gives, see set_defer_compaction), the
+        space is left in place and the block is compacted only when an add() or put() actually needs
+        the room.
+
+        If the page was handed out by a BufferPool, it works directly on the frame's memory
+        and the frame stays pinned until the page is deleted.
  *
  */
 class SlottedPage : public DbBlock {
 public:
-	SlottedPage(Dbt &block, BlockID block_id, bool is_new=false);
+	SlottedPage(Dbt &block, BlockID block_id, bool is_new=false, BufferFrame *frame=nullptr,
+				bool defer_compaction=false);
 	// Big 5 - we only need the destructor, copy-ctor, move-ctor, and op= are unnecessary
 	// but we delete them explicitly just to make sure we don't use them accidentally
-	virtual ~SlottedPage() {}
+	virtual ~SlottedPage();
 	SlottedPage(const SlottedPage& other) = delete;
 	SlottedPage(SlottedPage&& temp) = delete;
 	SlottedPage& operator=(const SlottedPage& other) = delete;
 	SlottedPage& operator=(SlottedPage& temp) = delete;
 
 	virtual RecordID add(const Dbt* data) throw(DbBlockNoRoomError);
+	virtual RecordID add(uint size, char **bytes) throw(DbBlockNoRoomError, std::logic_error);
 	virtual Dbt* get(RecordID record_id) const;
+	virtual RecordView view(RecordID record_id) const;
 	virtual void put(RecordID record_id, const Dbt &data) throw(DbBlockNoRoomError);
 	virtual void del(RecordID record_id);
 	virtual RecordIDs* ids(void) const;
+	virtual RecordIDIterator* scan_ids(void) const;
+	virtual uint free_space(void) const;
 
 protected:
+	friend class SlottedPageIDs;
+
+	static const uint16_t HEADER_SZ = 8;
+	static const uint16_t LEGACY_HEADER_SZ = 4;
+	static const uint16_t FORMAT = 0x8002;  // > any offset in a 4kB block (all blocks were 4kB before this format)
+
 	uint16_t num_records;
 	uint16_t end_free;
+	RecordID first_free;
+	uint16_t header_size;
+	uint16_t block_end;  // offset of the last usable byte
+	BufferFrame *frame;
+	bool defer_compaction;  // del() and shrinking put()s leave dead space until the room is needed
 
 	virtual void get_header(uint16_t &size, uint16_t &loc, RecordID id=0) const;
 	virtual void put_header(RecordID id=0, uint16_t size=0, uint16_t loc=0);
-	virtual bool has_room(uint16_t size) const;
+	virtual uint16_t slot_offset(RecordID id) const;
+	virtual RecordID next_free(RecordID id) const;
+	virtual bool has_room(uint size) const;
+	virtual bool make_room(uint size);
+	virtual uint data_size(void) const;
 	virtual void slide(uint16_t start, uint16_t end);
+	virtual void compact(void);
 	virtual uint16_t get_n(uint16_t offset) const;
 	virtual void put_n(uint16_t offset, uint16_t n);
 	virtual void* address(uint16_t offset) const;
+
+	/**
+	 * For blocks laid out another way (see PaxPage): take the block as it is, leaving its header
+	 * to the subclass.
+	 */
+	SlottedPage(Dbt &block, BlockID block_id, BufferFrame *frame);
 };
 
 /**
  * @class HeapFile - heap file implementation of DbFile
  *
  * Heap file organization. Built on top of Berkeley DB RecNo file. There is one of our
-        database blocks for each Berkeley DB record in the RecNo file. In this way we are using Berkeley DB
-        for buffer management and file management.
-        Uses SlottedPage for storing records within blocks.
+        database blocks for each Berkeley DB record in the RecNo file. Berkeley DB does the file
+        management; blocks are cached in a BufferPool, so get() pins a frame and put() only marks
+        it dirty. Dirty blocks reach the file when they are evicted, by the pool's flusher thread, or
+        at a checkpoint (flush/close); sync() also forces them to disk.
+        Uses SlottedPage for storing records within blocks, or PaxPage if the file was created with
+        the PAX_PAGES layout (whose user gives the width of each column with set_pax_widths()).
+        Every put() also records the block's remaining room in the file's FreeSpaceMap so that
+        get_with_room() can steer new records into space freed by deletes.
+        The block size is chosen when the file is created (it is Berkeley DB's record length);
+        opening an existing file picks up the size it was created with. The number of blocks
+        is kept in the free-space map's header, so opening a file doesn't have to count them.
+        The file grows an extent of empty blocks at a time; get_new() hands them out in order
+        and the ones not yet handed out are remembered in that header too, as are the format
+        of the records kept in the file (for the file's user to interpret) and the blocks' layout
+        (with whether slotted pages defer compaction).
+        Scans go through scan(), which reads blocks ahead in bulk (DB_MULTIPLE_KEY cursor gets)
+        into the buffer pool rather than looking each one up by key. Full scans that don't need the
+        blocks in order may be shared: one that starts while another is under way joins it at the
+        block it is on and goes round to the blocks before that at the end, so the two ask for the
+        same blocks at about the same time and each block is read from the file once, by whichever
+        gets to it first. Other scans (table scans, which promise rows in block order) start at
+        block 1 regardless.
  */
+class BlockScan;
+
 class HeapFile : public DbFile {
 public:
-	HeapFile(std::string name);
-	virtual ~HeapFile() {}
+	/**
+	 * Empty blocks added to a file at a time, unless set_extent_size() says otherwise.
+	 */
+	static const uint DEFAULT_EXTENT = 64;
+
+	/**
+	 * Layouts of the records within blocks.
+	 */
+	static const uint SLOTTED_PAGES = 0;  // SlottedPage
+	static const uint PAX_PAGES = 1;      // PaxPage
+
+	/**
+	 * Flag recorded along with the layout for a file whose SlottedPages defer compaction.
+	 */
+	static const uint DEFERRED_COMPACTION = 0x100;
+
+	HeapFile(std::string name, uint block_size=DbBlock::BLOCK_SZ, BufferPool &pool=BufferPool::shared());
+	virtual ~HeapFile();
 	HeapFile(const HeapFile& other) = delete;
 	HeapFile(HeapFile&& temp) = delete;
 	HeapFile& operator=(const HeapFile& other) = delete;
@@ -82,6 +172,24 @@ public:
 	virtual SlottedPage* get(BlockID block_id);
 	virtual void put(DbBlock* block);
 	virtual BlockIDs* block_ids() const;
+	virtual BlockIDIterator* scan_block_ids() const;
+
+	/**
+	 * Get a block with room for a new record, per the free-space map.
+	 * @param size  size of the record to be added
+	 * @returns     an existing block with enough room, else a new block (freed by caller)
+	 */
+	virtual SlottedPage* get_with_room(uint size);
+
+	/**
+	 * Write all of this file's dirty blocks out of the buffer pool.
+	 */
+	virtual void flush(void);
+
+	/**
+	 * Make all changes so far durable: flush, then have them forced to disk.
+	 */
+	virtual void sync(void);
 
 	/**
 	 * Get the id of the current final block in the heap file.
@@ -89,28 +197,256 @@ public:
 	 */
 	virtual uint32_t get_last_block_id() {return last;}
 
+	/**
+	 * Get the size of this file's blocks.
+	 * @returns  bytes per block
+	 */
+	virtual uint get_block_size() const {return block_size;}
+
+	/**
+	 * Set how many empty blocks are added to the file each time get_new() runs out.
+	 * @param blocks  blocks per extent (at least 1)
+	 */
+	virtual void set_extent_size(uint blocks) {extent_blocks = blocks > 0 ? blocks : 1;}
+
+	/**
+	 * Format of the records in the file, as set before the file was created.
+	 * @returns  format number (0 for a file made before formats were recorded)
+	 */
+	virtual uint get_record_format() const {return record_format;}
+
+	/**
+	 * Set the format of the records to go in the file; it is recorded when the file is created.
+	 * @param format  format number
+	 */
+	virtual void set_record_format(uint format) {record_format = format;}
+
+	/**
+	 * Layout of the file's blocks, as set before the file was created.
+	 * @returns  SLOTTED_PAGES or PAX_PAGES
+	 */
+	virtual uint get_page_layout() const {return page_layout;}
+
+	/**
+	 * Set the layout of the blocks of the file; it is recorded when the file is created.
+	 * @param layout  SLOTTED_PAGES or PAX_PAGES
+	 */
+	virtual void set_page_layout(uint layout) {page_layout = layout;}
+
+	/**
+	 * Set the width of each column of the records, for PAX_PAGES blocks (see PaxPage).
+	 * @param widths  bytes per value of each column, 0 for TEXT
+	 */
+	virtual void set_pax_widths(const std::vector<uint16_t> &widths) {pax_widths = widths;}
+
+	/**
+	 * Whether the file's slotted pages defer compaction, as set before the file was created.
+	 */
+	virtual bool get_defer_compaction() const {return defer_compaction;}
+
+	/**
+	 * Have the file's slotted pages leave the space of deleted records in place until it is needed
+	 * (see SlottedPage); it is recorded with the layout when the file is created. Suits files with
+	 * many deletes that are refilled later.
+	 * @param defer  true to defer compaction
+	 */
+	virtual void set_defer_compaction(bool defer) {defer_compaction = defer;}
+
+	/**
+	 * Check if the file has been created.
+	 */
+	virtual bool exists(void) const {return db_file_exists(this->dbfilename);}
+
+	/**
+	 * Hint that the blocks are about to be read in order (or that such a scan is over).
+	 * @param sequential  true at the start of a scan, false at the end
+	 */
+	virtual void advise_sequential(bool /*sequential*/) {}
+
+	/**
+	 * Start reading all the blocks.
+	 * @param shared  if true, join any other shared scan of the file under way (so the blocks come
+	 *                in order from where it is, then from the first block up to there); only for
+	 *                callers that don't care about block order
+	 * @returns       a scan positioned before its first block (freed by caller)
+	 */
+	virtual BlockScan* scan(bool shared=false);
+
+	/**
+	 * Get a run of blocks into the buffer pool ahead of their use, in as few reads as possible.
+	 * @param first  block id of the first block wanted
+	 * @param count  how many blocks are wanted
+	 * @returns      how many blocks starting at first are now ready (0 if first is past the end)
+	 */
+	virtual uint read_ahead(BlockID first, uint count);
+
 protected:
+	friend class BufferPool;
+	friend class BlockScan;
+
 	std::string dbfilename;
 	uint32_t last;
+	uint32_t allocated;  // last block id in the file; blocks after last are the empty reserve
+	uint extent_blocks;
+	uint record_format;
+	uint page_layout;
+	bool defer_compaction;
+	std::vector<uint16_t> pax_widths;
+	uint block_size;
 	bool closed;
 	Db db;
+	BufferPool &pool;
+	FreeSpaceMap fsm;
+	std::mutex scan_latch;  // guards shared_scans and scan_position
+	uint shared_scans;      // shared scans under way
+	BlockID scan_position;  // block the shared scan that moved last is on
 	virtual void db_open(uint flags=0);
+	virtual void fsm_open();
+	virtual void extend(void);
+	virtual SlottedPage* make_page(Dbt &data, BlockID block_id, bool is_new, BufferFrame *frame=nullptr);
 	virtual uint32_t get_block_count();
+	virtual bool has_block(BlockID block_id);
+	virtual void read_block(BlockID block_id, void *buffer);
+	virtual void write_block(BlockID block_id, const void *buffer);
+	virtual BlockID join_scan();
+	virtual void leave_scan();
+	virtual void report_scan(BlockID block_id);
+};
+
+/**
+ * @class BlockScan - hands out the blocks of a HeapFile in block id order.
+ *
+ * Blocks are read ahead in batches of READ_AHEAD with HeapFile::read_ahead, so a
+ * table scan costs a handful of bulk reads instead of one keyed lookup per block.
+ * A scan of the whole file includes blocks added to it while the scan is under way;
+ * a scan of a range of blocks stops at the end of the range. A shared scan (see HeapFile)
+ * that joined another part way through wraps around to block 1 at the end.
+ * With a BlockFilter, the blocks it doesn't want are passed over without being read (or
+ * read ahead); how many blocks scans have read and passed over is kept for statistics.
+ */
+class BlockScan {
+public:
+	/**
+	 * Number of blocks requested from the file at a time.
+	 */
+	static const uint READ_AHEAD = 32;
+
+	BlockScan(HeapFile *file, bool shared=false);
+	BlockScan(HeapFile *file, BlockID first, BlockID last);
+	virtual ~BlockScan();
+	BlockScan(const BlockScan& other) = delete;
+	BlockScan(BlockScan&& temp) = delete;
+	BlockScan& operator=(const BlockScan& other) = delete;
+	BlockScan& operator=(BlockScan&& temp) = delete;
+
+	/**
+	 * Get the next block.
+	 * @returns  the block, pinned as by HeapFile::get (freed by caller), or nullptr when there are no more
+	 */
+	virtual SlottedPage* next();
+
+	/**
+	 * Pass over the blocks the filter doesn't want from now on.
+	 * @param filter  nullptr for none (not freed by the scan, so must outlive it)
+	 */
+	virtual void set_filter(const BlockFilter *filter) { this->filter = filter; }
+
+	/**
+	 * Blocks handed out and passed over by all scans so far (each scan's are added when it ends).
+	 */
+	static unsigned long get_blocks_read() { return blocks_read; }
+	static unsigned long get_blocks_skipped() { return blocks_skipped; }
+	static void reset_stats() { blocks_read = blocks_skipped = 0; }
+
+protected:
+	static std::atomic<unsigned long> blocks_read;
+	static std::atomic<unsigned long> blocks_skipped;
+
+	HeapFile *file;
+	BlockID next_id;      // block to hand out next
+	BlockID ready_to;     // last block id read ahead so far
+	BlockID last_id;      // last block to hand out (0 for the last one in the file)
+	BlockID start_id;     // block the scan started at
+	bool shared;
+	bool wrapped;         // gone round to the blocks before start_id
+	const BlockFilter *filter;
+	unsigned long read;   // blocks handed out
+	unsigned long skipped;  // blocks passed over
 };
 
 /**
  * @class HeapTable - Heap storage engine (implementation of DbRelation)
+ *
+ * A TEXT value longer than a quarter of a block is stored out of line in the table's toast
+ * file (<table>.toast.db), split into a chain of chunk records:
+ *      Bytes 0x00 - 0x03: block id of next chunk (0 for the last one)
+ *      Bytes 0x04 - 0x05: record id of next chunk
+ *      Bytes 0x06 - ...:  the next piece of the value
+ * In the row itself, such a value is replaced by its length and the first chunk's handle
+ * (see RowCodec for where they go in each record format). For example, in the inline format it
+ * is a 12-byte pointer in place of the usual length and bytes:
+ *      Bytes 0x00 - 0x01: RowCodec::TOAST_POINTER (never a valid inline length)
+ *      Bytes 0x02 - 0x05: length of the value
+ *      Bytes 0x06 - 0x09: block id of first chunk
+ *      Bytes 0x0A - 0x0B: record id of first chunk
+ * The chain is only read when the column is projected, and it is freed when the row is deleted.
+ * The toast file is created the first time a value needs it.
+ * Rows are written and read by the table's RowCodec, made once from its column list. New tables
+ * use RowCodec::CURRENT_FORMAT; the format is kept in the file's header, so tables made
+ * before it changed are still read (and added to) in their own format.
+ *
+ * The table's blocks (and its toast file's) are either in Berkeley DB (HeapFile) or in a
+ * memory-mapped file (MmapFile), as chosen when the table is created. So is the layout of the
+ * records within the table's blocks: slotted pages, or PAX pages (PaxPage), which keep each
+ * column's values together so that scans reading or testing a few columns go through those
+ * columns' minipages. Rows are still added and deleted one at a time, in a single block.
+ *
+ * scan_project() can split a full scan across threads: the blocks are dealt out in runs of
+ * SCAN_CHUNK, each thread tests and projects the rows of the runs it takes, and the rows are
+ * put back together in block order. scan_batches() hands out rows a ColumnBatch at a time, the
+ * batched columns copied straight from the records where they can be.
+ *
+ * Scans with a where clause on INT or BOOLEAN columns pass over the blocks the table's ZoneMap
+ * rules out. The map is built the first time such a scan is started after the table is opened
+ * and is kept up to date by append() (and left alone by del()) from then on.
+ * Likewise, TEXT columns chosen with create_bloom_filters() get a Bloom filter per block
+ * (BloomFilters, in <table>.bloom.db), and scans for a value of one pass over the blocks whose
+ * filter doesn't have it. Those are kept on disk, and rebuilt from the table if found to be behind it.
  */
 
 class HeapTable : public DbRelation {
 public:
-	HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes );
-	virtual ~HeapTable() {}
+	/**
+	 * Where the table's blocks are kept.
+	 */
+	enum Storage {
+		BERKELEY_DB,  // HeapFile: a Berkeley DB RecNo file behind the BufferPool
+		MMAP          // MmapFile: a plain file mapped into memory
+	};
+
+	/**
+	 * How the records are laid out within the table's blocks (for a table being created;
+	 * an existing table keeps the layout it was created with).
+	 */
+	enum Layout {
+		SLOTTED,  // SlottedPage: each record's bytes together
+		PAX       // PaxPage: each column's values together
+	};
+
+	HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+			  uint block_size=DbBlock::BLOCK_SZ, Storage storage=BERKELEY_DB, Layout layout=SLOTTED);
+	virtual ~HeapTable();
 	HeapTable(const HeapTable& other) = delete;
 	HeapTable(HeapTable&& temp) = delete;
 	HeapTable& operator=(const HeapTable& other) = delete;
 	HeapTable& operator=(HeapTable&& temp) = delete;
 
+	/**
+	 * For a table being created: have its slotted pages defer compaction (see HeapFile).
+	 * An existing table keeps what it was created with.
+	 */
+	virtual void set_defer_compaction(bool defer) { file->set_defer_compaction(defer); }
+
 	virtual void create();
 	virtual void create_if_not_exists();
 	virtual void drop();
@@ -118,6 +454,11 @@ public:
 	virtual void open();
 	virtual void close();
 
+	/**
+	 * Make all changes to the table so far durable (see HeapFile::sync).
+	 */
+	virtual void sync();
+
 	virtual Handle insert(const ValueDict* row);
 	virtual void update(const Handle handle, const ValueDict* new_values);
 	virtual void del(const Handle handle);
@@ -125,18 +466,81 @@ public:
 	virtual Handles* select();
 	virtual Handles* select(const ValueDict* where);
 	virtual Handles* select(Handles *current_selection, const ValueDict* where);
+	virtual HandleIterator* scan(const ValueDict* where=nullptr);
+	virtual ValueTuples* scan_project(const ValueDict* where, const ColumnOrdinals* ordinals, uint parallelism=1);
+	virtual ColumnBatchIterator* scan_batches(const ColumnOrdinals* ordinals, const ValueDict* where=nullptr,
+											  uint capacity=ColumnBatch::DEFAULT_CAPACITY);
 	virtual ValueDict* project(Handle handle);
 	virtual ValueDict* project(Handle handle, const ColumnNames* column_names);
+	virtual ValueTuple* project(Handle handle, const ColumnOrdinals* ordinals);
 	using DbRelation::project;
 
+	/**
+	 * Keep Bloom filters on the given TEXT columns from now on (replacing any the table had), and
+	 * fill them in from the rows already in the table.
+	 * @param fp_rate  chance a scan for a value reads a block without it (see BloomFilters)
+	 * @throws         DbRelationError for a column that isn't TEXT or a rate out of range
+	 */
+	virtual void create_bloom_filters(const ColumnNames &column_names, double fp_rate=BloomFilters::DEFAULT_FP_RATE);
+
+	/**
+	 * Stop keeping Bloom filters, if the table had any.
+	 */
+	virtual void drop_bloom_filters();
+
+	/**
+	 * Columns with Bloom filters (none if the table hasn't any or isn't open).
+	 */
+	virtual const ColumnOrdinals& get_bloom_columns() const { return blooms.get_columns(); }
+
 protected:
-	HeapFile file;
-	virtual ValueDict* validate(const ValueDict* row) const;
-	virtual Handle append(const ValueDict* row);
-	virtual Dbt* marshal(const ValueDict* row) const;
-	virtual ValueDict* unmarshal(Dbt* data) const;
-	virtual bool selected(Handle handle, const ValueDict* where);
+	friend class HeapTableScan;
+	friend class HeapTableBatchScan;
+
+	static const uint TOAST_FRACTION = 4;  // TEXT longer than block size / TOAST_FRACTION goes out of line
+	static const uint TOAST_LINK_SZ = sizeof(BlockID) + sizeof(RecordID);
+	static const uint SCAN_CHUNK = 4 * BlockScan::READ_AHEAD;  // blocks a scan_project thread takes at a time
+	static const uint BLOOM_ROW_SZ = 64;  // bytes per row assumed when sizing Bloom filters for an empty table
+
+	HeapFile *file;
+	HeapFile *toast;
+	bool toast_ready;
+	RowCodec codec;
+	ZoneMap zones;
+	BloomFilters blooms;
+	bool blooms_ready;  // blooms opened (and brought up to date) if the table has them
+	bool pax;           // the table's blocks are PaxPages
+	virtual ValueTuple* validate(const ValueDict* row) const;
+	virtual Handle append(const ValueTuple* row);
+	virtual Handle store(HeapFile &into, const Dbt* data);
+	virtual SlottedPage* room_for(HeapFile &into, uint size, RecordID &record_id, char **bytes);
+	virtual SlottedPage* room_for(HeapFile &into, const Dbt* data, RecordID &record_id);
+	virtual void unmarshal(RecordView data, ValueTuple &row, const ColumnOrdinals* ordinals=nullptr);
+	virtual void unmarshal(const SlottedPage* block, RecordID record_id, ValueTuple &row,
+						   const ColumnOrdinals* ordinals=nullptr);
+	virtual RowPredicate* predicate(const ValueDict* where) const;
+	virtual bool selected(RecordView data, const RowPredicate* where, ValueTuple &row);
+	virtual bool selected(const SlottedPage* block, RecordID record_id, const RowPredicate* where, ValueTuple &row);
+	virtual bool present(const SlottedPage* block, RecordID record_id) const;
+	virtual BlockFilter* block_filter(const ValueDict* where);
+	virtual void build_zones();
+	virtual void open_blooms();
+	virtual void build_blooms();
+	virtual void scan_blocks(BlockID first, BlockID last, const RowPredicate* where, const BlockFilter* filter,
+							 const ColumnOrdinals* ordinals, ValueTuples &rows);
+
+	virtual HeapFile& toast_file();
+	virtual Handle toast_put(const std::string &value);
+	virtual std::string toast_get(Handle chunk, uint32_t size);
+	virtual void toast_del(Handle chunk);
 };
 
 bool test_heap_storage();
 
+// rows of (a INT, b TEXT, c BOOLEAN) for the storage tests: c is whether a is even
+void test_set_row(ValueDict &row, int a, std::string b);
+bool test_compare(DbRelation &table, Handle handle, int a, std::string b);
+
+void benchmark_slotted_page();
+void benchmark_heap_table();
+
@@ -0,0 +1,349 @@
+/**
+ * @file int_filter.cpp - implementation of:
+ * IntFilter
+ * IntFilterScan
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "int_filter.h"
+#include "heap_storage.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+using namespace std;
+
+typedef void (*Kernel)(const int32_t *values, uint n, int32_t low, int32_t high, uint64_t *bits);
+
+template <IntFilter::Op OP>
+static inline bool passes(int32_t value, int32_t low, int32_t high) {
+	switch (OP) {
+		case IntFilter::EQ:
+			return value == low;
+		case IntFilter::LT:
+			return value < low;
+		case IntFilter::GT:
+			return value > low;
+		default:
+			return low <= value && value <= high;
+	}
+}
+
+// Bits for the first count (at most 64) of values, one at a time.
+template <IntFilter::Op OP>
+static uint64_t scalar_word(const int32_t *values, uint count, int32_t low, int32_t high) {
+	uint64_t word = 0;
+	for (uint i = 0; i < count; i++)
+		word |= (uint64_t)passes<OP>(values[i], low, high) << i;
+	return word;
+}
+
+template <IntFilter::Op OP>
+static void scalar_kernel(const int32_t *values, uint n, int32_t low, int32_t high, uint64_t *bits) {
+	for (uint w = 0; w * 64 < n; w++)
+		bits[w] = scalar_word<OP>(values + w * 64, min(n - w * 64, 64U), low, high);
+}
+
+#ifdef HAVE_X86_KERNELS
+// All ones in the lanes that pass. BETWEEN is "not below low and not above high".
+template <IntFilter::Op OP>
+__attribute__((target("sse2")))
+static inline __m128i sse2_compare(__m128i values, __m128i low, __m128i high) {
+	switch (OP) {
+		case IntFilter::EQ:
+			return _mm_cmpeq_epi32(values, low);
+		case IntFilter::LT:
+			return _mm_cmpgt_epi32(low, values);
+		case IntFilter::GT:
+			return _mm_cmpgt_epi32(values, low);
+		default:
+			return _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(low, values), _mm_cmpgt_epi32(values, high)),
+									_mm_set1_epi32(-1));
+	}
+}
+
+template <IntFilter::Op OP>
+__attribute__((target("sse2")))
+static void sse2_kernel(const int32_t *values, uint n, int32_t low, int32_t high, uint64_t *bits) {
+	__m128i lows = _mm_set1_epi32(low);
+	__m128i highs = _mm_set1_epi32(high);
+	uint words = n / 64;
+	for (uint w = 0; w < words; w++) {
+		const int32_t *in = values + w * 64;
+		uint64_t word = 0;
+		for (uint i = 0; i < 64; i += 4) {
+			__m128i lanes = _mm_loadu_si128((const __m128i*)(in + i));
+			word |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(sse2_compare<OP>(lanes, lows, highs))) << i;
+		}
+		bits[w] = word;
+	}
+	if (n % 64 != 0)
+		bits[words] = scalar_word<OP>(values + words * 64, n % 64, low, high);
+}
+
+template <IntFilter::Op OP>
+__attribute__((target("avx2")))
+static inline __m256i avx2_compare(__m256i values, __m256i low, __m256i high) {
+	switch (OP) {
+		case IntFilter::EQ:
+			return _mm256_cmpeq_epi32(values, low);
+		case IntFilter::LT:
+			return _mm256_cmpgt_epi32(low, values);
+		case IntFilter::GT:
+			return _mm256_cmpgt_epi32(values, low);
+		default:
+			return _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(low, values), _mm256_cmpgt_epi32(values, high)),
+									   _mm256_set1_epi32(-1));
+	}
+}
+
+template <IntFilter::Op OP>
+__attribute__((target("avx2")))
+static void avx2_kernel(const int32_t *values, uint n, int32_t low, int32_t high, uint64_t *bits) {
+	__m256i lows = _mm256_set1_epi32(low);
+	__m256i highs = _mm256_set1_epi32(high);
+	uint words = n / 64;
+	for (uint w = 0; w < words; w++) {
+		const int32_t *in = values + w * 64;
+		uint64_t word = 0;
+		for (uint i = 0; i < 64; i += 8) {
+			__m256i lanes = _mm256_loadu_si256((const __m256i*)(in + i));
+			word |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(avx2_compare<OP>(lanes, lows, highs))) << i;
+		}
+		bits[w] = word;
+	}
+	if (n % 64 != 0)
+		bits[words] = scalar_word<OP>(values + words * 64, n % 64, low, high);
+}
+#endif
+
+// kernels[isa][op]
+static const Kernel kernels[3][4] = {
+		{scalar_kernel<IntFilter::EQ>, scalar_kernel<IntFilter::LT>, scalar_kernel<IntFilter::GT>,
+		 scalar_kernel<IntFilter::BETWEEN>},
+#ifdef HAVE_X86_KERNELS
+		{sse2_kernel<IntFilter::EQ>, sse2_kernel<IntFilter::LT>, sse2_kernel<IntFilter::GT>,
+		 sse2_kernel<IntFilter::BETWEEN>},
+		{avx2_kernel<IntFilter::EQ>, avx2_kernel<IntFilter::LT>, avx2_kernel<IntFilter::GT>,
+		 avx2_kernel<IntFilter::BETWEEN>}
+#else
+		{nullptr, nullptr, nullptr, nullptr},
+		{nullptr, nullptr, nullptr, nullptr}
+#endif
+};
+
+bool IntFilter::has_isa(Isa isa) {
+	switch (isa) {
+		case SCALAR:
+			return true;
+#ifdef HAVE_X86_KERNELS
+		case SSE2:
+			__builtin_cpu_init();  // may be asked before the runtime has looked at the processor
+			return __builtin_cpu_supports("sse2");
+		case AVX2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+static IntFilter::Isa best_isa() {
+	if (IntFilter::has_isa(IntFilter::AVX2))
+		return IntFilter::AVX2;
+	if (IntFilter::has_isa(IntFilter::SSE2))
+		return IntFilter::SSE2;
+	return IntFilter::SCALAR;
+}
+
+IntFilter::Isa IntFilter::isa = best_isa();
+
+bool IntFilter::set_isa(Isa isa) {
+	if (!has_isa(isa))
+		return false;
+	IntFilter::isa = isa;
+	return true;
+}
+
+const char* IntFilter::isa_name(Isa isa) {
+	switch (isa) {
+		case SSE2:
+			return "sse2";
+		case AVX2:
+			return "avx2";
+		default:
+			return "scalar";
+	}
+}
+
+void IntFilter::evaluate(const int32_t *values, uint n, uint64_t *bits) const {
+	kernels[IntFilter::isa][this->op](values, n, this->low, this->high, bits);
+}
+
+void IntFilter::apply(ColumnBatch &batch, uint column, vector<uint64_t> &bits) const {
+	const ColumnBatch::Column &values = batch.column(column);
+	if (values.data_type == ColumnAttribute::TEXT)
+		throw DbRelationError("only INT and BOOLEAN columns can be filtered by value range");
+	uint n = batch.size();
+	bits.resize((n + 63) / 64);
+	evaluate(values.ints.data(), n, bits.data());
+	vector<uint> &selection = batch.get_selection();
+	uint kept = 0;
+	for (auto row: selection)
+		if ((bits[row / 64] >> (row % 64)) & 1)
+			selection[kept++] = row;
+	selection.resize(kept);
+}
+
+bool IntFilterScan::next(ColumnBatch &batch) {
+	while (this->batches->next(batch)) {
+		for (auto const& filter: this->filters)
+			filter.second.apply(batch, filter.first, this->bits);
+		if (!batch.get_selection().empty())
+			return true;
+	}
+	return false;
+}
+
+// Microbenchmark of the kernels on one core: each comparison over a batch's worth of values, many
+// times, with each instruction set the processor has, against Value::operator== one value at a time.
+void benchmark_int_filter() {
+	const uint n = ColumnBatch::DEFAULT_CAPACITY;
+	const int rounds = 1 << 15;
+	vector<int32_t> values(n);
+	uint32_t seed = 12345;
+	for (auto &value: values) {
+		seed = seed * 1103515245 + 12345;
+		value = (int32_t)((seed >> 8) % 1000);
+	}
+	vector<uint64_t> bits((n + 63) / 64);
+	IntFilter filters[] = {IntFilter(IntFilter::EQ, 500), IntFilter(IntFilter::LT, 100), IntFilter(IntFilter::GT, 900),
+						   IntFilter(IntFilter::BETWEEN, 250, 749)};
+	const char *names[] = {"=", "<", ">", "between"};
+
+	vector<Value> boxed(values.begin(), values.end());
+	Value wanted(values[0]);
+	uint matches = 0;
+	auto start = chrono::steady_clock::now();
+	for (int round = 0; round < rounds; round++)
+		for (auto const& value: boxed)
+			matches += value == wanted;
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << "int filter, Value ==: " << (int)(n * (double)rounds / secs / 1e6) << "M rows/s" << (matches == 0 ? "!" : "") << endl;
+
+	IntFilter::Isa saved = IntFilter::get_isa();
+	IntFilter::Isa isas[] = {IntFilter::SCALAR, IntFilter::SSE2, IntFilter::AVX2};
+	for (auto isa: isas) {
+		if (!IntFilter::set_isa(isa))
+			continue;
+		cout << "int filter, " << IntFilter::isa_name(isa) << ":";
+		for (uint f = 0; f < 4; f++) {
+			start = chrono::steady_clock::now();
+			for (int round = 0; round < rounds; round++)
+				filters[f].evaluate(values.data(), n, bits.data());
+			secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			cout << " " << names[f] << " " << (int)(n * (double)rounds / secs / 1e6) << "M rows/s";
+		}
+		cout << endl;
+	}
+	IntFilter::set_isa(saved);
+}
+
+// test function -- returns true if all tests pass
+bool test_int_filter() {
+	cout << "test_int_filter: " << endl;
+
+	// every kernel the processor has gives the same bits as the scalar one, tail included
+	vector<int32_t> values(1000 + 37);
+	for (uint i = 0; i < values.size(); i++)
+		values[i] = (int32_t)(i * 7919) % 201 - 100;
+	values[3] = INT32_MIN;
+	values[4] = INT32_MAX;
+	IntFilter kernel_tests[] = {IntFilter(IntFilter::EQ, 5), IntFilter(IntFilter::LT, -20), IntFilter(IntFilter::GT, 60),
+								IntFilter(IntFilter::BETWEEN, -10, 10), IntFilter(IntFilter::BETWEEN, INT32_MIN, INT32_MAX),
+								IntFilter(IntFilter::GT, INT32_MAX)};
+	IntFilter::Isa best = IntFilter::get_isa();
+	vector<uint64_t> expected_bits((values.size() + 63) / 64), bits(expected_bits.size());
+	bool kernels_ok = IntFilter::has_isa(best);
+	for (auto const& filter: kernel_tests) {
+		IntFilter::set_isa(IntFilter::SCALAR);
+		filter.evaluate(values.data(), (uint)values.size(), expected_bits.data());
+		for (auto isa: {IntFilter::SSE2, IntFilter::AVX2}) {
+			if (!IntFilter::set_isa(isa))
+				continue;
+			filter.evaluate(values.data(), (uint)values.size(), bits.data());
+			if (bits != expected_bits)
+				kernels_ok = false;
+		}
+	}
+	IntFilter::set_isa(best);
+	IntFilter(IntFilter::BETWEEN, -10, 10).evaluate(values.data(), (uint)values.size(), bits.data());
+	for (uint i = 0; i < values.size(); i++)
+		if (((bits[i / 64] >> (i % 64)) & 1) != (uint64_t)(values[i] >= -10 && values[i] <= 10))
+			kernels_ok = false;
+	if (!kernels_ok)
+		return false;
+	cout << "int filters ok (" << IntFilter::isa_name(best) << ")" << endl;
+
+	// a filter scan passes on just the rows that pass all its filters, from however many batches
+	vector<ColumnBatch>* batches = new vector<ColumnBatch>(25);
+	ColumnAttributes b_then_a({ColumnAttribute(ColumnAttribute::TEXT), ColumnAttribute(ColumnAttribute::INT)});
+	for (int i = 0; i < 2500; i++) {
+		ColumnBatch &batch = (*batches)[i / 100];
+		if (i % 100 == 0)
+			batch.reset(b_then_a, 100);
+		batch.append(Handle(i / 100 + 1, i % 100 + 1), ValueTuple({Value(string(i % 5, 'b')), Value(i)}));
+	}
+	for (auto &batch: *batches)
+		batch.select_all();
+	IntFilterScan filtered(new VectorIterator<ColumnBatch>(batches));
+	filtered.add(1, IntFilter(IntFilter::BETWEEN, 1000, 1099));
+	filtered.add(1, IntFilter(IntFilter::LT, 1050));
+	ColumnBatch batch;
+	int i = 1000;
+	bool scan_ok = true;
+	while (filtered.next(batch))
+		for (auto r: batch.get_selection()) {
+			if (batch.column(1).ints[r] != i || batch.get_handles()[r] != Handle(i / 100 + 1, i % 100 + 1))
+				scan_ok = false;
+			i++;
+		}
+	try {
+		IntFilter(IntFilter::EQ, 0).apply(batch, 0, bits);
+		scan_ok = false;
+	} catch (DbRelationError &e) {}  // only INT and BOOLEAN columns
+	if (!scan_ok || i != 1050)
+		return false;
+
+	// and the same over a HeapTable's batch scan (a is the batches' second column)
+	ColumnNames column_names({"a", "b", "c"});
+	ColumnAttributes column_attributes({ColumnAttribute(ColumnAttribute::INT), ColumnAttribute(ColumnAttribute::TEXT),
+										ColumnAttribute(ColumnAttribute::BOOLEAN)});
+	HeapTable table("_test_int_filter_cpp", column_names, column_attributes);
+	table.create();
+	ValueDict row;
+	for (i = 0; i < 2500; i++) {
+		test_set_row(row, i, string(i % 5, 'b'));
+		table.insert(&row);
+	}
+	ColumnOrdinals b_then_a_ordinals({1, 0});
+	IntFilterScan table_filtered(table.scan_batches(&b_then_a_ordinals, nullptr, 100));
+	table_filtered.add(1, IntFilter(IntFilter::BETWEEN, 1000, 1099));
+	table_filtered.add(1, IntFilter(IntFilter::LT, 1050));
+	i = 1000;
+	while (table_filtered.next(batch))
+		for (auto r: batch.get_selection()) {
+			if (batch.column(1).ints[r] != i || batch.get(0, r) != Value(string(i % 5, 'b')))
+				scan_ok = false;
+			i++;
+		}
+	table.drop();
+	if (!scan_ok || i != 1050)
+		return false;
+	cout << "int filter scan ok" << endl;
+	return true;
+}
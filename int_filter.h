@@ -0,0 +1,105 @@
+/**
+ * @file int_filter.h - comparisons of INT and BOOLEAN columns, evaluated a batch of values at a time.
+ * IntFilter
+ * IntFilterScan
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "storage_engine.h"
+
+/**
+ * @class IntFilter - compares int32 values against a constant (or a pair of them for BETWEEN).
+ *
+ * Values are evaluated in bulk into a bitmap: bit i % 64 of bits[i / 64] is set if values[i]
+ * passes. The work is done by a kernel for the widest instruction set the processor has,
+ * picked once at startup:
+ *      AVX2:   8 values per compare
+ *      SSE2:   4 values per compare (the comparisons needed are all in SSE2, so SSE4 adds nothing)
+ *      SCALAR: one at a time, for other processors
+ * All of them give the same bits.
+ */
+class IntFilter {
+public:
+	enum Op {
+		EQ,      // value == low
+		LT,      // value < low
+		GT,      // value > low
+		BETWEEN  // low <= value <= high
+	};
+
+	enum Isa {
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	IntFilter(Op op, int32_t low, int32_t high=0) : op(op), low(low), high(high) {}
+	virtual ~IntFilter() {}
+
+	/**
+	 * Test n values.
+	 * @param bits  set to one bit per value (room for (n + 63) / 64 words)
+	 */
+	virtual void evaluate(const int32_t *values, uint n, uint64_t *bits) const;
+
+	/**
+	 * Narrow a batch's selection to the rows whose value in the given column passes.
+	 * @param column  an INT or BOOLEAN column of the batch
+	 * @param bits    scratch space for the bitmap (reused from batch to batch)
+	 */
+	virtual void apply(ColumnBatch &batch, uint column, std::vector<uint64_t> &bits) const;
+
+	/**
+	 * Instruction set the kernels use. set_isa() is for comparing them; it refuses (returning false)
+	 * one the processor doesn't have.
+	 */
+	static Isa get_isa() {return isa;}
+	static bool set_isa(Isa isa);
+	static bool has_isa(Isa isa);
+	static const char* isa_name(Isa isa);
+
+protected:
+	Op op;
+	int32_t low;
+	int32_t high;
+
+	static Isa isa;
+};
+
+/**
+ * @class IntFilterScan - the batches of another batch scan, narrowed by IntFilters.
+ *
+ * Each filter applies to one of the batches' columns; a row stays selected only if it passes
+ * all of them. Batches left with nothing selected are skipped.
+ */
+class IntFilterScan : public ColumnBatchIterator {
+public:
+	/**
+	 * @param batches  batches to filter (freed with this)
+	 */
+	IntFilterScan(ColumnBatchIterator *batches) : batches(batches), filters(), bits() {}
+	virtual ~IntFilterScan() {delete batches;}
+	IntFilterScan(const IntFilterScan& other) = delete;
+	IntFilterScan(IntFilterScan&& temp) = delete;
+	IntFilterScan& operator=(const IntFilterScan& other) = delete;
+	IntFilterScan& operator=(IntFilterScan&& temp) = delete;
+
+	/**
+	 * Add a filter on one of the batches' columns.
+	 */
+	virtual void add(uint column, IntFilter filter) {filters.push_back(std::make_pair(column, filter));}
+
+	virtual bool next(ColumnBatch &batch);
+
+protected:
+	ColumnBatchIterator *batches;
+	std::vector<std::pair<uint, IntFilter>> filters;
+	std::vector<uint64_t> bits;
+};
+
+bool test_int_filter();
+void benchmark_int_filter();
@@ -0,0 +1,195 @@
+/**
+ * @file mmap_file.cpp - implementation of:
+ * MmapFile
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <fcntl.h>
+#include <memory.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include "mmap_file.h"
+using namespace std;
+
+// Path of a file in the database environment's home directory (where Berkeley DB puts its files).
+static string env_path(string filename) {
+	const char *home = nullptr;
+	_DB_ENV->get_home(&home);
+	return home == nullptr ? filename : string(home) + "/" + filename;
+}
+
+MmapFile::MmapFile(string name, uint block_size) : HeapFile(name, block_size), path(""), fd(-1), map(nullptr),
+		file_size(0) {
+	this->dbfilename = this->name + ".heap";
+	this->path = env_path(this->dbfilename);
+}
+
+// HeapFile's destructor can't reach our close(), so close here.
+MmapFile::~MmapFile() {
+	close();
+}
+
+// Delete the physical file.
+void MmapFile::drop(void) {
+	this->fsm.drop();
+	close();
+	::unlink(this->path.c_str());
+}
+
+// Unmap and close the physical file. The kernel writes back whatever flush() hasn't.
+void MmapFile::close(void) {
+	this->fsm.close();
+	if (this->map != nullptr) {
+		munmap(this->map, MAP_SZ);
+		this->map = nullptr;
+	}
+	if (this->fd >= 0) {
+		::close(this->fd);
+		this->fd = -1;
+	}
+	this->closed = true;
+}
+
+// Allocate a new block, growing the file by an extent if it is full.
+SlottedPage* MmapFile::get_new(void) {
+	BlockID block_id = this->last + 1;
+	grow(block_id);
+	this->last = block_id;
+	put_header();
+	Dbt data(address(block_id), this->block_size);
+	SlottedPage* page = make_page(data, block_id, true);
+	this->fsm.set(block_id, page->free_space());
+	return page;
+}
+
+// The block is used right where it is mapped.
+SlottedPage* MmapFile::get(BlockID block_id) {
+	if (block_id == 0 || block_id > this->last)
+		throw DbRelationError("block " + to_string(block_id) + " not found in " + this->dbfilename);
+	Dbt data(address(block_id), this->block_size);
+	return make_page(data, block_id, false);
+}
+
+// Changes are already in the mapping; just note the room left.
+void MmapFile::put(DbBlock* block) {
+	this->fsm.set(block->get_block_id(), block->free_space());
+}
+
+// Checkpoint: force the mapped blocks out to the file.
+void MmapFile::flush(void) {
+	if (this->map != nullptr)
+		msync(this->map, (size_t)(this->last + 1) * this->block_size, MS_SYNC);
+	this->fsm.flush();
+}
+
+// flush() already waits for msync.
+void MmapFile::sync(void) {
+	flush();
+	this->fsm.sync();
+}
+
+bool MmapFile::exists(void) const {
+	struct stat st;
+	return ::stat(this->path.c_str(), &st) == 0;
+}
+
+// Tell the kernel to read ahead (and drop pages behind) while a scan runs.
+void MmapFile::advise_sequential(bool sequential) {
+	if (this->map != nullptr)
+		madvise(this->map, (size_t)this->file_size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+}
+
+// Ask the kernel to start paging the blocks in; they are used straight from the mapping.
+uint MmapFile::read_ahead(BlockID first, uint count) {
+	if (first == 0 || first > this->last)
+		return 0;
+	count = min(count, this->last - first + 1);
+	madvise(address(first), (size_t)count * this->block_size, MADV_WILLNEED);
+	return count;
+}
+
+// Open (or create) the file and map it. An existing file keeps the block size it was created with.
+void MmapFile::db_open(uint flags) {
+	if (!this->closed)
+		return;
+	int open_flags = O_RDWR;
+	if (flags & DB_CREATE)
+		open_flags |= O_CREAT;
+	if (flags & DB_EXCL)
+		open_flags |= O_EXCL;
+	this->fd = ::open(this->path.c_str(), open_flags, 0644);
+	if (this->fd < 0)
+		throw DbRelationError("cannot open " + this->path + ": " + strerror(errno));
+	struct stat st;
+	fstat(this->fd, &st);
+	this->file_size = (uint64_t)st.st_size;
+	void *map = mmap(nullptr, MAP_SZ, PROT_READ|PROT_WRITE, MAP_SHARED, this->fd, 0);
+	if (map == MAP_FAILED) {
+		close();
+		throw DbRelationError("cannot map " + this->path + ": " + strerror(errno));
+	}
+	this->map = (char*)map;
+
+	if (this->file_size == 0) {
+		this->last = 0;
+		grow(0);
+		put_header();
+	} else {
+		if (*(uint32_t*)this->map != MAGIC) {
+			close();
+			throw DbRelationError(this->path + " is not a heap file");
+		}
+		this->block_size = *(uint32_t*)(this->map + 4);
+		this->fsm.set_block_size(this->block_size);
+		this->last = get_block_count();
+	}
+	this->closed = false;
+}
+
+uint32_t MmapFile::get_block_count() {
+	return *(uint32_t*)(this->map + 8);
+}
+
+bool MmapFile::has_block(BlockID block_id) {
+	return block_id > 0 && block_id <= get_block_count();
+}
+
+void MmapFile::read_block(BlockID block_id, void *buffer) {
+	if (block_id == 0 || block_id > this->last)
+		throw DbRelationError("block " + to_string(block_id) + " not found in " + this->dbfilename);
+	memcpy(buffer, address(block_id), this->block_size);
+}
+
+void MmapFile::write_block(BlockID block_id, const void *buffer) {
+	grow(block_id);
+	memcpy(address(block_id), buffer, this->block_size);
+}
+
+// Make sure the file is big enough to hold the given block, adding at least an extent.
+void MmapFile::grow(BlockID block_id) {
+	uint64_t needed = (uint64_t)(block_id + 1) * this->block_size;
+	if (needed <= this->file_size)
+		return;
+	if (needed > MAP_SZ)
+		throw DbRelationError(this->dbfilename + " is full");
+	uint64_t new_size = max(needed, this->file_size + EXTENT_SZ);
+	if (new_size > MAP_SZ)
+		new_size = MAP_SZ;
+	int err = posix_fallocate(this->fd, (off_t)this->file_size, (off_t)(new_size - this->file_size));
+	if (err != 0)
+		throw DbRelationError("cannot grow " + this->dbfilename + ": " + strerror(err));
+	this->file_size = new_size;
+}
+
+char* MmapFile::address(BlockID block_id) const {
+	return this->map + (uint64_t)block_id * this->block_size;
+}
+
+void MmapFile::put_header() {
+	*(uint32_t*)this->map = MAGIC;
+	*(uint32_t*)(this->map + 4) = this->block_size;
+	*(uint32_t*)(this->map + 8) = this->last;
+}
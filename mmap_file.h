@@ -0,0 +1,75 @@
+/**
+ * @file mmap_file.h - HeapFile kept in a memory-mapped plain file.
+ * MmapFile
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include "heap_storage.h"
+
+/**
+ * @class MmapFile - HeapFile whose blocks live in a plain file mapped into memory
+ *
+ * An alternative to the Berkeley DB RecNo file: the file (<name>.heap in the
+ * database environment's home directory) is mapped once when it is opened and
+ * a block is just an address in that mapping, so get() neither copies nor goes
+ * through the BufferPool. Block i is at offset i * block size; block 0 is the
+ * file header:
+ *      Bytes 0x00 - 0x03: magic number
+ *      Bytes 0x04 - 0x07: block size
+ *      Bytes 0x08 - 0x0B: last block id in use
+ *
+ * The file is grown an extent at a time. The mapping reserves MAP_SZ bytes of
+ * address space up front so that growing never moves it and blocks handed out
+ * earlier stay valid. Changes reach the file through the shared mapping;
+ * flush() forces them out. Reading ahead is left to the kernel, with madvise.
+ * The free-space map is kept as for any HeapFile.
+ */
+class MmapFile : public HeapFile {
+public:
+	/**
+	 * Address space reserved for each mapping (the largest the file can grow)
+	 */
+	static const uint64_t MAP_SZ = 1ULL << 36;
+
+	/**
+	 * Bytes added to the file each time it runs out of room
+	 */
+	static const uint EXTENT_SZ = 1 << 20;
+
+	MmapFile(std::string name, uint block_size=DbBlock::BLOCK_SZ);
+	virtual ~MmapFile();
+	MmapFile(const MmapFile& other) = delete;
+	MmapFile(MmapFile&& temp) = delete;
+	MmapFile& operator=(const MmapFile& other) = delete;
+	MmapFile& operator=(MmapFile&& temp) = delete;
+
+	virtual void drop(void);
+	virtual void close(void);
+	virtual SlottedPage* get_new(void);
+	virtual SlottedPage* get(BlockID block_id);
+	virtual void put(DbBlock* block);
+	virtual void flush(void);
+	virtual void sync(void);
+	virtual bool exists(void) const;
+	virtual void advise_sequential(bool sequential);
+	virtual uint read_ahead(BlockID first, uint count);
+
+protected:
+	static const uint32_t MAGIC = 0x4D4D4831;  // "MMH1"
+
+	std::string path;
+	int fd;
+	char *map;
+	uint64_t file_size;
+
+	virtual void db_open(uint flags=0);
+	virtual uint32_t get_block_count();
+	virtual bool has_block(BlockID block_id);
+	virtual void read_block(BlockID block_id, void *buffer);
+	virtual void write_block(BlockID block_id, const void *buffer);
+	virtual void grow(BlockID block_id);
+	virtual char* address(BlockID block_id) const;
+	virtual void put_header();
+};
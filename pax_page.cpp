@@ -0,0 +1,522 @@
+/**
+ * @file pax_page.cpp - implementation of:
+ * PaxPage
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <memory.h>
+#include <algorithm>
+#include <iostream>
+#include "pax_page.h"
+using namespace std;
+
+typedef uint16_t u16;
+
+// Values may sit at any offset in a record, so they are copied in and out rather than cast.
+static inline u16 load_n(const char *in) {
+	u16 n;
+	memcpy(&n, in, sizeof(u16));
+	return n;
+}
+
+// Minipages start on 4-byte boundaries.
+static inline uint align(uint offset) {
+	return (offset + 3) & ~3U;
+}
+
+PaxPage::PaxPage(Dbt &block, BlockID block_id, const vector<u16> &widths, bool is_new, BufferFrame *frame)
+		: SlottedPage(block, block_id, frame), widths(widths), fixed_row(0), text_columns(0), columns(0),
+		  capacity(0), minipage(), gathered() {
+	for (auto width: widths) {
+		this->fixed_row += width != 0 ? width : TEXT_SLOT_SZ;
+		if (width == 0)
+			this->text_columns++;
+	}
+	if (is_new) {
+		this->num_records = 0;
+		this->end_free = this->block_end;
+		this->columns = (u16)widths.size();
+		this->capacity = capacity_for(0, 0);
+		layout(this->capacity, this->columns, this->minipage);
+		memset(this->address(PAX_HEADER_SZ), 0, (this->capacity + 7) / 8);
+		put_n(0x0A, 0);
+		write_header();
+	} else {
+		if (get_n(6) != PAX_FORMAT)
+			throw DbRelationError("block " + to_string(block_id) + " is not a PAX block");
+		if (get_n(8) > widths.size())
+			throw DbRelationError("block " + to_string(block_id) + " has " + to_string(get_n(8)) + " columns, table has "
+								  + to_string(widths.size()));
+		this->num_records = get_n(0);
+		this->end_free = get_n(2);
+		refresh();
+	}
+}
+
+// Add a record (in the offsets format) to the block. Return its id.
+// The id of a deleted record is reused if there is one.
+RecordID PaxPage::add(const Dbt* data) throw(DbBlockNoRoomError) {
+	Fields fields;
+	split(*data, fields);
+	refresh();
+	RecordID id = lowest_free();
+	place(id, fields);
+	return id;
+}
+
+RecordID PaxPage::add(uint, char **) throw(DbBlockNoRoomError, std::logic_error) {
+	throw logic_error("records of a PAX block can't be written in place; add them as a Dbt");
+}
+
+// Put the record back together. Null if it has been deleted.
+RecordView PaxPage::view(RecordID record_id) const {
+	if (!has(record_id))
+		return RecordView();
+	u16 m = this->columns;
+	uint t = 0;
+	string &out = this->gathered;
+	out.clear();
+	out.append((const char*)&m, sizeof(u16));
+	for (uint column = 0; column < m; column++) {
+		if (this->widths[column] != 0)
+			out.append(fixed(record_id, column), this->widths[column]);
+		else
+			t++;
+	}
+	uint table = (uint)out.size();
+	out.append(t * sizeof(u16) + (t + 7) / 8, '\0');
+	uint flags = table + t * (uint)sizeof(u16);
+	for (uint column = 0, j = 0; column < m; column++) {
+		if (this->widths[column] != 0)
+			continue;
+		uint size;
+		bool out_of_line;
+		const char *in = text(record_id, column, size, out_of_line);
+		out.append(in, size);
+		u16 end = (u16)out.size();
+		memcpy(&out[table + j * sizeof(u16)], &end, sizeof(u16));
+		if (out_of_line)
+			out[flags + j / 8] |= (char)(1 << (j % 8));
+		j++;
+	}
+	return RecordView(out.data(), (uint)out.size());
+}
+
+// Replace the record with the given data. Raises DbBlockNoRoomError (leaving the record as it was)
+// if it won't fit.
+void PaxPage::put(RecordID record_id, const Dbt &data) throw(DbBlockNoRoomError) {
+	Fields fields;
+	split(data, fields);
+	refresh();
+	place(record_id, fields);
+}
+
+// Clear the record's flag. Its variable-length bytes are left until the page is laid out anew.
+void PaxPage::del(RecordID record_id) {
+	if (!has(record_id))
+		return;
+	refresh();
+	forget(record_id);
+	if (record_id == this->num_records) {
+		while (this->num_records > 0 && !has(this->num_records))
+			this->num_records--;
+	}
+	if (this->num_records == 0) {
+		// nothing left, so nothing in the variable-length area either
+		this->end_free = this->block_end;
+		put_n(0x0A, 0);
+	}
+	write_header();
+}
+
+// Sequence of all non-deleted record IDs.
+RecordIDs* PaxPage::ids(void) const {
+	RecordIDs* vec = new RecordIDs();
+	for (RecordID record_id = 1; record_id <= this->num_records; record_id++)
+		if (has(record_id))
+			vec->push_back(record_id);
+	return vec;
+}
+
+/**
+ * @class PaxPageIDs - the live record ids of a PaxPage, read off its flags as they are asked for.
+ * As for SlottedPageIDs, the record count is re-read each time.
+ */
+class PaxPageIDs : public RecordIDIterator {
+public:
+	PaxPageIDs(const PaxPage *page) : page(page), record_id(0) {}
+
+	virtual bool next(RecordID &item) {
+		while (this->record_id < this->page->get_n(0)) {
+			this->record_id++;
+			if (this->page->has(this->record_id)) {
+				item = this->record_id;
+				return true;
+			}
+		}
+		return false;
+	}
+
+protected:
+	const PaxPage *page;
+	RecordID record_id;  // last one handed out
+};
+
+RecordIDIterator* PaxPage::scan_ids(void) const {
+	return new PaxPageIDs(this);
+}
+
+// Size of the biggest offsets-format record that would fit, laying the page out anew if need be:
+// the variable-length bytes that would fit beside minipages for one more record, plus what the
+// rest of such a record takes.
+uint PaxPage::free_space(void) const {
+	refresh();
+	uint least = max((uint)this->num_records, (uint)lowest_free());
+	int rest = (int)this->block_end + 1 - (int)slots_end(least, (uint)this->widths.size()) - (int)var_in_use();
+	if (rest < 0)
+		return 0;
+	uint fixed = this->fixed_row - this->text_columns * TEXT_SLOT_SZ;
+	uint t = this->text_columns;
+	return (uint)rest + (uint)sizeof(u16) + fixed + t * (uint)sizeof(u16) + (t + 7) / 8;
+}
+
+bool PaxPage::has(RecordID record_id) const {
+	if (record_id == 0 || record_id > get_n(0))
+		return false;
+	uint i = record_id - 1U;
+	return (*((const char*)this->address(PAX_HEADER_SZ) + i / 8) & (1 << (i % 8))) != 0;
+}
+
+const char* PaxPage::fixed(RecordID record_id, uint column) const {
+	refresh();
+	if (column >= this->columns)
+		return nullptr;
+	return (const char*)this->address((u16)(this->minipage[column] + (record_id - 1U) * this->widths[column]));
+}
+
+const char* PaxPage::text(RecordID record_id, uint column, uint &size, bool &out_of_line) const {
+	refresh();
+	if (column >= this->columns) {
+		size = 0;
+		out_of_line = false;
+		return nullptr;
+	}
+	u16 slot = (u16)(this->minipage[column] + (record_id - 1U) * TEXT_SLOT_SZ);
+	u16 loc = get_n(slot);
+	u16 n = get_n((u16)(slot + 2));
+	out_of_line = (n & OUT_OF_LINE) != 0;
+	size = n & (u16)~OUT_OF_LINE;
+	return (const char*)this->address(loc);
+}
+
+// Find the values of an offsets-format record: one field per column of the table, those past
+// the end of the record (written before columns were added) left null, i.e., the default.
+// A record that doesn't fit the columns (add() and put() can only raise DbBlockNoRoomError) has
+// no room in the block.
+void PaxPage::split(const Dbt &data, Fields &fields) const {
+	const char *record = (const char*)data.get_data();
+	uint n = data.get_size() >= sizeof(u16) ? load_n(record) : 0;
+	if (n > this->widths.size())
+		throw DbBlockNoRoomError("record has " + to_string(n) + " columns, table has " + to_string(this->widths.size()));
+	Field none = {nullptr, 0, false};
+	fields.assign(this->widths.size(), none);
+	uint fixed = 0, t = 0;
+	for (uint column = 0; column < n; column++) {
+		fixed += this->widths[column];
+		if (this->widths[column] == 0)
+			t++;
+	}
+	const char *table = record + sizeof(u16) + fixed;
+	const char *flags = table + t * sizeof(u16);
+	uint at = (uint)sizeof(u16);
+	uint begin = (uint)(sizeof(u16) + fixed + t * sizeof(u16) + (t + 7) / 8);
+	for (uint column = 0, j = 0; column < n; column++) {
+		Field &field = fields[column];
+		if (this->widths[column] != 0) {
+			field.data = record + at;
+			field.size = this->widths[column];
+			at += this->widths[column];
+			continue;
+		}
+		uint end = load_n(table + j * sizeof(u16));
+		if (end < begin || end > data.get_size())
+			throw DbBlockNoRoomError("bad offset in record for block " + to_string(this->block_id));
+		field.data = record + begin;
+		field.size = (u16)(end - begin);
+		field.out_of_line = (flags[j / 8] & (1 << (j % 8))) != 0;
+		begin = end;
+		j++;
+	}
+}
+
+// Put a record's fields in as record_id (new, or replacing the one there), laying the page out anew
+// if it is out of minipage slots or variable-length space. Nothing is changed if it won't fit.
+void PaxPage::place(RecordID record_id, const Fields &fields) {
+	uint var = 0;
+	for (uint column = 0; column < fields.size(); column++)
+		if (this->widths[column] == 0)
+			var += fields[column].size;
+	uint old = has(record_id) ? text_size(record_id) : 0;
+	int room = (int)this->end_free + 1 - (int)slots_end(this->capacity, this->columns);
+	if (this->columns < this->widths.size() || record_id > this->capacity || (int)var > room) {
+		uint records = live() + (has(record_id) ? 0 : 1);
+		uint in_use = var_in_use() - old + var;
+		u16 least = (u16)max((uint)this->num_records, (uint)record_id);
+		u16 capacity = max(capacity_for(records, in_use), least);
+		if (!fits(capacity, in_use)) {
+			capacity = least;
+			if (!fits(capacity, in_use))
+				throw DbBlockNoRoomError("not enough room for new record");
+		}
+		forget(record_id);
+		reorganize(capacity);
+	} else {
+		forget(record_id);
+	}
+	write(record_id, fields);
+}
+
+// Write a record's values into its minipage slots and the variable-length area (which has room).
+void PaxPage::write(RecordID record_id, const Fields &fields) {
+	uint i = record_id - 1U;
+	for (uint column = 0; column < this->columns; column++) {
+		const Field &field = fields[column];
+		u16 width = this->widths[column];
+		if (width != 0) {
+			void *to = this->address((u16)(this->minipage[column] + i * width));
+			if (field.data != nullptr)
+				memcpy(to, field.data, width);
+			else
+				memset(to, 0, width);
+			continue;
+		}
+		this->end_free -= field.size;
+		u16 loc = (u16)(this->end_free + 1U);
+		if (field.size > 0)
+			memcpy(this->address(loc), field.data, field.size);
+		u16 slot = (u16)(this->minipage[column] + i * TEXT_SLOT_SZ);
+		put_n(slot, loc);
+		put_n((u16)(slot + 2), (u16)(field.size | (field.out_of_line ? OUT_OF_LINE : 0)));
+	}
+	set_present(record_id, true);
+	if (record_id > this->num_records)
+		this->num_records = record_id;
+	write_header();
+}
+
+// Check if minipages with the given capacity (for all the table's columns) leave room for in_use
+// bytes of variable-length values.
+bool PaxPage::fits(u16 capacity, uint in_use) const {
+	return slots_end(capacity, (uint)this->widths.size()) + in_use <= this->block_end + 1U;
+}
+
+// Lay the page out anew, with minipages of the given capacity for all the table's columns (in
+// case some have been added), and the variable-length values of the records there packed against
+// the end of the block. Record ids stay as they are.
+void PaxPage::reorganize(u16 capacity) {
+	string old((const char*)this->address(0), this->block_end + 1U);
+	uint old_columns = this->columns;
+	vector<uint> old_minipage;
+	layout(this->capacity, old_columns, old_minipage);
+
+	this->columns = (u16)this->widths.size();
+	this->capacity = capacity;
+	layout(this->capacity, this->columns, this->minipage);
+	memset(this->address(PAX_HEADER_SZ), 0, slots_end(this->capacity, this->columns) - PAX_HEADER_SZ);
+	uint end = this->block_end + 1U;
+	for (RecordID record_id = 1; record_id <= this->num_records; record_id++) {
+		uint i = record_id - 1U;
+		if ((old[PAX_HEADER_SZ + i / 8] & (1 << (i % 8))) == 0)
+			continue;
+		set_present(record_id, true);
+		for (uint column = 0; column < old_columns; column++) {
+			u16 width = this->widths[column];
+			if (width != 0) {
+				memcpy(this->address((u16)(this->minipage[column] + i * width)),
+					   old.data() + old_minipage[column] + i * width, width);
+				continue;
+			}
+			const char *slot = old.data() + old_minipage[column] + i * TEXT_SLOT_SZ;
+			u16 n = load_n(slot + 2);
+			u16 size = n & (u16)~OUT_OF_LINE;
+			end -= size;
+			memcpy(this->address((u16)end), old.data() + load_n(slot), size);
+			u16 to = (u16)(this->minipage[column] + i * TEXT_SLOT_SZ);
+			put_n(to, (u16)end);
+			put_n((u16)(to + 2), n);
+		}
+	}
+	this->end_free = (u16)(end - 1);
+	put_n(0x0A, 0);
+	write_header();
+}
+
+// Clear a record's flag and count its variable-length bytes as given up.
+void PaxPage::forget(RecordID record_id) {
+	if (!has(record_id))
+		return;
+	put_n(0x0A, (u16)(get_n(0x0A) + text_size(record_id)));
+	set_present(record_id, false);
+}
+
+// Bytes a record has in the variable-length area.
+uint PaxPage::text_size(RecordID record_id) const {
+	uint total = 0;
+	for (uint column = 0; column < this->columns; column++) {
+		if (this->widths[column] != 0)
+			continue;
+		u16 slot = (u16)(this->minipage[column] + (record_id - 1U) * TEXT_SLOT_SZ);
+		total += get_n((u16)(slot + 2)) & (u16)~OUT_OF_LINE;
+	}
+	return total;
+}
+
+// Bytes of the variable-length area still belonging to records.
+uint PaxPage::var_in_use(void) const {
+	return (uint)this->block_end - this->end_free - get_n(0x0A);
+}
+
+// Number of records in the block.
+uint PaxPage::live(void) const {
+	uint n = 0;
+	for (RecordID record_id = 1; record_id <= this->num_records; record_id++)
+		if (has(record_id))
+			n++;
+	return n;
+}
+
+// Capacity to lay the page out with (for all the table's columns) so that its minipages and
+// variable-length area fill up together, for records with as many variable-length bytes on average
+// as the given ones (DEFAULT_TEXT_SZ per TEXT value if there are none).
+u16 PaxPage::capacity_for(uint records, uint in_use) const {
+	uint average = records > 0 ? (in_use + records - 1) / records : DEFAULT_TEXT_SZ * this->text_columns;
+	uint m = (uint)this->widths.size();
+	int space = (int)this->block_end + 1 - PAX_HEADER_SZ - 3 * (int)(m + 1);  // 3: most padding per minipage
+	if (space <= 0)
+		return 1;
+	uint capacity = (uint)space * 8 / (8 * (this->fixed_row + average) + 1);
+	capacity = min(capacity, (uint)UINT16_MAX);
+	while (capacity > 1 && slots_end(capacity, m) + capacity * average > this->block_end + 1U)
+		capacity--;
+	return (u16)max(capacity, 1U);
+}
+
+// Where minipages with the given capacity for the first m columns would end.
+uint PaxPage::slots_end(uint capacity, uint m) const {
+	uint at = align(PAX_HEADER_SZ + (capacity + 7) / 8);
+	for (uint column = 0; column < m; column++)
+		at = align(at + capacity * (this->widths[column] != 0 ? this->widths[column] : TEXT_SLOT_SZ));
+	return at;
+}
+
+// Where each of the first m columns' minipages starts, for the given capacity.
+void PaxPage::layout(uint capacity, uint m, vector<uint> &minipage) const {
+	minipage.resize(m);
+	uint at = align(PAX_HEADER_SZ + (capacity + 7) / 8);
+	for (uint column = 0; column < m; column++) {
+		minipage[column] = at;
+		at = align(at + capacity * (this->widths[column] != 0 ? this->widths[column] : TEXT_SLOT_SZ));
+	}
+}
+
+// Pick up a new layout if the page has been laid out anew (through another page on the same frame).
+void PaxPage::refresh(void) const {
+	u16 capacity = get_n(4);
+	u16 columns = get_n(8);
+	if (capacity == this->capacity && columns == this->columns && this->minipage.size() == columns)
+		return;
+	this->capacity = capacity;
+	this->columns = columns;
+	layout(capacity, columns, this->minipage);
+}
+
+void PaxPage::write_header(void) {
+	put_n(0, this->num_records);
+	put_n(2, this->end_free);
+	put_n(4, this->capacity);
+	put_n(6, PAX_FORMAT);
+	put_n(8, this->columns);
+}
+
+void PaxPage::set_present(RecordID record_id, bool present) {
+	uint i = record_id - 1U;
+	char *flags = (char*)this->address(PAX_HEADER_SZ) + i / 8;
+	if (present)
+		*flags |= (char)(1 << (i % 8));
+	else
+		*flags &= (char)~(1 << (i % 8));
+}
+
+// Lowest deleted record id, or the next one after the last if there are none.
+RecordID PaxPage::lowest_free(void) const {
+	const unsigned char *flags = (const unsigned char*)this->address(PAX_HEADER_SZ);
+	for (uint byte = 0; byte < (this->num_records + 7U) / 8; byte++) {
+		if (flags[byte] == 0xFF)
+			continue;
+		for (uint bit = 0; bit < 8; bit++)
+			if ((flags[byte] & (1 << bit)) == 0) {
+				RecordID record_id = (RecordID)(byte * 8 + bit + 1);
+				return record_id <= this->num_records ? record_id : (RecordID)(this->num_records + 1);
+			}
+	}
+	return (RecordID)(this->num_records + 1);
+}
+
+// test function -- returns true if all tests pass
+bool test_pax_page() {
+	ColumnAttributes column_attributes({ColumnAttribute(ColumnAttribute::INT), ColumnAttribute(ColumnAttribute::TEXT),
+										ColumnAttribute(ColumnAttribute::BOOLEAN)});
+	int i;
+	cout << "test_pax_page: " << endl;
+
+	// a PAX page gives back the records it was given, byte for byte, as it is laid out anew to fit them
+	vector<u16> widths({4, 0, 1});
+	RowCodec pax_codec(column_attributes);
+	char pax_block[DbBlock::BLOCK_SZ];
+	Dbt pax_data(pax_block, sizeof(pax_block));
+	PaxPage page(pax_data, 1, widths, true);
+	uint first_capacity = page.get_capacity();
+	vector<string> records;
+	ValueTuple tuple(3);
+	bool pax_ok = true;
+	try {
+		for (i = 0; ; i++) {
+			tuple[0] = Value(i * 1000);
+			tuple[1] = Value(string(20 + i % 60, (char)('a' + i % 26)));
+			tuple[2] = Value(i % 3 == 0);
+			string record(pax_codec.size(tuple, UINT32_MAX), '\0');
+			pax_codec.encode(tuple, UINT32_MAX, Handles(), &record[0]);
+			Dbt data(&record[0], (uint)record.size());
+			pax_ok = pax_ok && page.add(&data) == (RecordID)(i + 1);
+			records.push_back(record);
+		}
+	} catch (DbBlockNoRoomError &e) {}
+	pax_ok = pax_ok && records.size() > 40 && page.get_capacity() != first_capacity;
+	for (i = 0; i < (int)records.size(); i++) {
+		RecordView data = page.view((RecordID)(i + 1));
+		ValueTuple decoded;
+		pax_codec.decode(page, (RecordID)(i + 1), decoded);
+		pax_ok = pax_ok && string(data.get_data(), data.get_size()) == records[i]
+				 && decoded[0].n == i * 1000 && decoded[1].s.length() == 20U + i % 60;
+	}
+	page.del(3);
+	page.del(7);
+	pax_ok = pax_ok && page.view(3).is_null() && !page.has(7);
+	Dbt again(&records[0][0], (uint)records[0].size());
+	pax_ok = pax_ok && page.add(&again) == 3 && page.add(&again) == 7;
+	RecordView third = page.view(3);
+	pax_ok = pax_ok && string(third.get_data(), third.get_size()) == records[0];
+	Dbt longer(&records[5][0], (uint)records[5].size());
+	page.put(1, longer);
+	RecordView first = page.view(1);
+	pax_ok = pax_ok && string(first.get_data(), first.get_size()) == records[5];
+	try {
+		char *bytes;
+		page.add(10, &bytes);
+		pax_ok = false;
+	} catch (logic_error &e) {}
+	if (!pax_ok)
+		return false;
+	cout << "pax page ok" << endl;
+	return true;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file pax_page.h - PAX (Partition Attributes Across) layout for HeapFile blocks.
+ * PaxPage: SlottedPage
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include "heap_storage.h"
+
+/**
+ * @class PaxPage - a block whose records are kept a column at a time, in minipages.
+ *
+ * Each record is still added, deleted and looked at whole, and stays in its block, but within the
+ * block the values of each column sit together: a scan testing or reading one column goes through
+ * that column's minipage instead of stepping from record to record. Records come in and go out in
+ * RowCodec's offsets format (as a HeapTable writes them), split up and put back together by the
+ * page; its user says what the columns are when it makes the page:
+ *      widths  bytes each column's values take (4 for INT, 1 for BOOLEAN), or 0 for TEXT
+ *
+ * Layout:
+ *      Bytes 0x00 - 0x01: number of record ids in use (including deleted ones), n
+ *      Bytes 0x02 - 0x03: offset to end of free space
+ *      Bytes 0x04 - 0x05: capacity, c: the most records the minipages have room for
+ *      Bytes 0x06 - 0x07: FORMAT
+ *      Bytes 0x08 - 0x09: number of columns
+ *      Bytes 0x0A - 0x0B: bytes of the variable-length area given up by deleted records
+ *      Bytes 0x0C - ...:  (c + 7) / 8 bytes of flags: bit i - 1 is set if record i is there
+ *      then a minipage per column, in column order, each starting on a 4-byte boundary:
+ *          INT, BOOLEAN: the c records' values, as laid out by ColumnCodec
+ *          TEXT:         for each of the c records, the 2-byte offset and 2-byte size of its value
+ *                        in the variable-length area; the size has OUT_OF_LINE set for a value
+ *                        kept in the table's toast file (whose TOAST_REF_SZ-byte reference is
+ *                        what the variable-length area has instead)
+ *      then free space
+ *      then the variable-length area, growing down from the end of the block
+ *
+ * Record ids are handed out as for SlottedPage: sequentially, the lowest deleted one first.
+ * Deleting a record just clears its flag. When a record won't fit, the page is laid out anew:
+ * the capacity is set from the average size of the records so far (see reorganize()), and the
+ * space deleted records had in the variable-length area is squeezed out. A new page is laid out
+ * for records with DEFAULT_TEXT_SZ bytes of each TEXT value.
+ *
+ * view() puts a record back together in a buffer held by the page, so a view is good only until
+ * the next view() of the same page (or a change to it). fixed() and text() get at one value where
+ * it sits, without that. Pages of one buffer frame that are laid out anew through another page
+ * object are noticed (by their capacity) the next time they are read.
+ */
+class PaxPage : public SlottedPage {
+public:
+	static const uint16_t OUT_OF_LINE = 0x8000;  // flag in a TEXT value's size (inline values are smaller)
+	static const uint DEFAULT_TEXT_SZ = 16;
+
+	/**
+	 * @param widths  width of each column (0 for TEXT); must outlive the page
+	 */
+	PaxPage(Dbt &block, BlockID block_id, const std::vector<uint16_t> &widths, bool is_new=false,
+			BufferFrame *frame=nullptr);
+	virtual ~PaxPage() {}
+	PaxPage(const PaxPage& other) = delete;
+	PaxPage(PaxPage&& temp) = delete;
+	PaxPage& operator=(const PaxPage& other) = delete;
+	PaxPage& operator=(PaxPage& temp) = delete;
+
+	virtual RecordID add(const Dbt* data) throw(DbBlockNoRoomError);
+
+	/**
+	 * Not possible with this layout: a record's bytes aren't kept together, so there is nowhere
+	 * to write them in place. Use add(data).
+	 * @throws  std::logic_error always
+	 */
+	virtual RecordID add(uint, char **) throw(DbBlockNoRoomError, std::logic_error);
+
+	virtual RecordView view(RecordID record_id) const;
+	virtual void put(RecordID record_id, const Dbt &data) throw(DbBlockNoRoomError);
+	virtual void del(RecordID record_id);
+	virtual RecordIDs* ids(void) const;
+	virtual RecordIDIterator* scan_ids(void) const;
+	virtual uint free_space(void) const;
+
+	/**
+	 * Check if the page has the record (not deleted).
+	 */
+	bool has(RecordID record_id) const;
+
+	/**
+	 * Where a fixed-width column's value of a record is (nullptr if the page was laid out before
+	 * the column was added, so the record has the default).
+	 */
+	const char* fixed(RecordID record_id, uint column) const;
+
+	/**
+	 * Where a TEXT column's value of a record is (nullptr, as for fixed()).
+	 * @param size         set to its length
+	 * @param out_of_line  set if what is there is a toast reference rather than the value
+	 */
+	const char* text(RecordID record_id, uint column, uint &size, bool &out_of_line) const;
+
+	uint get_capacity() const {refresh(); return capacity;}
+
+protected:
+	friend class PaxPageIDs;
+
+	static const uint16_t PAX_HEADER_SZ = 12;
+	static const uint16_t PAX_FORMAT = 0x8003;  // unlike SlottedPage::FORMAT, so the layouts can't be mixed up
+	static const uint16_t TEXT_SLOT_SZ = 4;     // offset and size of a TEXT value
+
+	// one value of a record being added, as found in its offsets-format bytes
+	struct Field {
+		const char *data;  // nullptr for a column the record doesn't have
+		uint16_t size;
+		bool out_of_line;
+	};
+	typedef std::vector<Field> Fields;
+
+	const std::vector<uint16_t> &widths;
+	uint fixed_row;     // bytes of minipage slots each record takes
+	uint text_columns;
+	mutable uint16_t columns;                // columns the page is laid out for (the table's, unless some were added since)
+	mutable uint16_t capacity;
+	mutable std::vector<uint> minipage;      // where each column's minipage starts
+	mutable std::string gathered;            // the record last put back together by view()
+
+	virtual void split(const Dbt &data, Fields &fields) const;
+	virtual void place(RecordID record_id, const Fields &fields);
+	virtual void write(RecordID record_id, const Fields &fields);
+	virtual bool fits(uint16_t capacity, uint in_use) const;
+	virtual void reorganize(uint16_t capacity);
+	virtual void forget(RecordID record_id);
+	virtual uint text_size(RecordID record_id) const;
+	virtual uint var_in_use(void) const;
+	virtual uint live(void) const;
+	virtual uint16_t capacity_for(uint records, uint in_use) const;
+	virtual uint slots_end(uint capacity, uint m) const;
+	virtual void layout(uint capacity, uint m, std::vector<uint> &minipage) const;
+	virtual void refresh(void) const;
+	virtual void write_header(void);
+	virtual void set_present(RecordID record_id, bool present);
+	virtual RecordID lowest_free(void) const;
+};
+
+bool test_pax_page();
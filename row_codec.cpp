@@ -0,0 +1,713 @@
+/**
+ * @file row_codec.cpp - implementation of:
+ * ColumnCodec
+ * RowCodec
+ * RowPredicate
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <memory.h>
+#include <algorithm>
+#include <iostream>
+#include "row_codec.h"
+#include "pax_page.h"
+using namespace std;
+
+typedef uint16_t u16;
+
+// Values may sit at any offset in a record, so they are copied in and out rather than cast.
+template <typename N>
+static inline N load(const char *in) {
+	N n;
+	memcpy(&n, in, sizeof(N));
+	return n;
+}
+
+template <typename N>
+static inline void store(char *out, N n) {
+	memcpy(out, &n, sizeof(N));
+}
+
+template <>
+struct ColumnCodec<ColumnAttribute::INT> {
+	static const uint WIDTH = sizeof(int32_t);
+	static uint size(const Value &/*value*/, uint /*toast_limit*/) {
+		return sizeof(int32_t);
+	}
+	static char* encode(char *out, const Value &value, uint /*toast_limit*/, const Handle *&/*chunk*/) {
+		store<int32_t>(out, value.n);
+		return out + sizeof(int32_t);
+	}
+	static const char* decode(const char *in, Value &value, uint /*column*/, ToastRefs* /*toasted*/) {
+		value.data_type = ColumnAttribute::INT;
+		value.n = load<int32_t>(in);
+		return in + sizeof(int32_t);
+	}
+	static const char* skip(const char *in, uint /*column*/, ToastRefs* /*toasted*/) {
+		return in + sizeof(int32_t);
+	}
+};
+
+template <>
+struct ColumnCodec<ColumnAttribute::TEXT> {
+	static const uint WIDTH = 0;
+	static uint size(const Value &value, uint toast_limit) {
+		if (value.s.length() > toast_limit)
+			return RowCodec::TOAST_POINTER_SZ;
+		return (uint)(sizeof(u16) + value.s.length());
+	}
+	static char* encode(char *out, const Value &value, uint toast_limit, const Handle *&chunk) {
+		uint32_t size = (uint32_t)value.s.length();
+		if (size > toast_limit) {
+			store<u16>(out, RowCodec::TOAST_POINTER);
+			store<uint32_t>(out + 2, size);
+			store<BlockID>(out + 6, chunk->first);
+			store<RecordID>(out + 10, chunk->second);
+			chunk++;
+			return out + RowCodec::TOAST_POINTER_SZ;
+		}
+		store<u16>(out, (u16)size);
+		memcpy(out + sizeof(u16), value.s.data(), size);  // assume ascii for now
+		return out + sizeof(u16) + size;
+	}
+	static const char* decode(const char *in, Value &value, uint column, ToastRefs *toasted) {
+		value.data_type = ColumnAttribute::TEXT;
+		u16 size = load<u16>(in);
+		if (size == RowCodec::TOAST_POINTER) {
+			value.s.clear();
+			return skip(in, column, toasted);
+		}
+		value.s.assign(in + sizeof(u16), size);
+		return in + sizeof(u16) + size;
+	}
+	static const char* skip(const char *in, uint column, ToastRefs *toasted) {
+		u16 size = load<u16>(in);
+		if (size != RowCodec::TOAST_POINTER)
+			return in + sizeof(u16) + size;
+		if (toasted != nullptr)
+			toasted->push_back({column, load<uint32_t>(in + 2), Handle(load<BlockID>(in + 6), load<RecordID>(in + 10))});
+		return in + RowCodec::TOAST_POINTER_SZ;
+	}
+};
+
+template <>
+struct ColumnCodec<ColumnAttribute::BOOLEAN> {
+	static const uint WIDTH = sizeof(uint8_t);
+	static uint size(const Value &/*value*/, uint /*toast_limit*/) {
+		return sizeof(uint8_t);
+	}
+	static char* encode(char *out, const Value &value, uint /*toast_limit*/, const Handle *&/*chunk*/) {
+		*(uint8_t*)out = (uint8_t)value.n;
+		return out + sizeof(uint8_t);
+	}
+	static const char* decode(const char *in, Value &value, uint /*column*/, ToastRefs* /*toasted*/) {
+		value.data_type = ColumnAttribute::BOOLEAN;
+		value.n = *(const uint8_t*)in;
+		return in + sizeof(uint8_t);
+	}
+	static const char* skip(const char *in, uint /*column*/, ToastRefs* /*toasted*/) {
+		return in + sizeof(uint8_t);
+	}
+};
+
+template <ColumnAttribute::DataType T>
+RowCodec::Step RowCodec::step() {
+	Step s;
+	s.data_type = T;
+	s.width = ColumnCodec<T>::WIDTH;
+	s.size = &ColumnCodec<T>::size;
+	s.encode = &ColumnCodec<T>::encode;
+	s.decode = &ColumnCodec<T>::decode;
+	s.skip = &ColumnCodec<T>::skip;
+	return s;
+}
+
+RowCodec::RowCodec(const ColumnAttributes &column_attributes, uint format)
+		: steps(), format(FORMAT_INLINE), fixed_before(1, 0), text_before(1, 0) {
+	for (auto ca: column_attributes) {
+		switch (ca.get_data_type()) {
+			case ColumnAttribute::INT:
+				this->steps.push_back(step<ColumnAttribute::INT>());
+				break;
+			case ColumnAttribute::TEXT:
+				this->steps.push_back(step<ColumnAttribute::TEXT>());
+				break;
+			case ColumnAttribute::BOOLEAN:
+				this->steps.push_back(step<ColumnAttribute::BOOLEAN>());
+				break;
+			default:
+				throw DbRelationError("Only know how to marshal INT, TEXT, and BOOLEAN");
+		}
+		const Step &step = this->steps.back();
+		this->fixed_before.push_back(this->fixed_before.back() + step.width);
+		this->text_before.push_back(this->text_before.back() + (step.data_type == ColumnAttribute::TEXT ? 1 : 0));
+	}
+	set_format(format);
+}
+
+void RowCodec::set_format(uint format) {
+	if (format == 0)
+		format = FORMAT_INLINE;
+	if (format != FORMAT_INLINE && format != FORMAT_OFFSETS)
+		throw DbRelationError("unknown record format " + to_string(format));
+	this->format = format;
+}
+
+// In the offsets format, where the fixed-width values of a record of n columns end (and its
+// offset table starts), and where its TEXT values' bytes start.
+static inline uint table_at(const vector<uint> &fixed_before, uint n) {
+	return (uint)sizeof(u16) + fixed_before[n];
+}
+
+static inline uint text_data_at(const vector<uint> &fixed_before, const vector<uint> &text_before, uint n) {
+	uint t = text_before[n];
+	return table_at(fixed_before, n) + t * (uint)sizeof(u16) + (t + 7) / 8;
+}
+
+uint RowCodec::size(const ValueTuple &row, uint toast_limit) const {
+	uint size = 0;
+	if (this->format == FORMAT_OFFSETS) {
+		uint n = (uint)this->steps.size();
+		size = text_data_at(this->fixed_before, this->text_before, n);
+		for (uint i = 0; i < n; i++)
+			if (this->steps[i].data_type == ColumnAttribute::TEXT)
+				size += row[i].s.length() > toast_limit ? TOAST_REF_SZ : (uint)row[i].s.length();
+		return size;
+	}
+	for (uint i = 0; i < this->steps.size(); i++)
+		size += this->steps[i].size(row[i], toast_limit);
+	return size;
+}
+
+vector<uint> RowCodec::toasting(const ValueTuple &row, uint toast_limit) const {
+	vector<uint> columns;
+	for (uint i = 0; i < this->steps.size(); i++)
+		if (this->steps[i].data_type == ColumnAttribute::TEXT && row[i].s.length() > toast_limit)
+			columns.push_back(i);
+	return columns;
+}
+
+void RowCodec::encode(const ValueTuple &row, uint toast_limit, const Handles &chunks, char *out) const {
+	const Handle *chunk = chunks.data();
+	if (this->format == FORMAT_OFFSETS) {
+		uint n = (uint)this->steps.size();
+		char *table = out + table_at(this->fixed_before, n);
+		char *flags = table + this->text_before[n] * sizeof(u16);
+		uint t = this->text_before[n];
+		memset(flags, 0, (t + 7) / 8);
+		uint at = text_data_at(this->fixed_before, this->text_before, n);
+		store<u16>(out, (u16)n);
+		for (uint i = 0, j = 0; i < n; i++) {
+			const Step &step = this->steps[i];
+			if (step.data_type != ColumnAttribute::TEXT) {
+				step.encode(out + sizeof(u16) + this->fixed_before[i], row[i], toast_limit, chunk);
+				continue;
+			}
+			uint32_t size = (uint32_t)row[i].s.length();
+			if (size > toast_limit) {
+				store<uint32_t>(out + at, size);
+				store<BlockID>(out + at + 4, chunk->first);
+				store<RecordID>(out + at + 8, chunk->second);
+				chunk++;
+				flags[j / 8] |= (char)(1 << (j % 8));
+				at += TOAST_REF_SZ;
+			} else {
+				memcpy(out + at, row[i].s.data(), size);  // assume ascii for now
+				at += size;
+			}
+			store<u16>(table + j * sizeof(u16), (u16)at);
+			j++;
+		}
+		return;
+	}
+	for (uint i = 0; i < this->steps.size(); i++)
+		out = this->steps[i].encode(out, row[i], toast_limit, chunk);
+}
+
+// Number of columns an offsets-format record was written with.
+uint RowCodec::columns_in(RecordView data) const {
+	if (data.get_size() < sizeof(u16))
+		return 0;
+	uint n = load<u16>(data.get_data());
+	if (n > this->steps.size())
+		throw DbRelationError("record has " + to_string(n) + " columns, table has " + to_string(this->steps.size()));
+	return n;
+}
+
+// Where TEXT column's value is in an offsets-format record of n columns (column < n).
+const char* RowCodec::text_at(const char *record, uint n, uint column, uint &size, bool &out_of_line) const {
+	uint j = this->text_before[column];
+	const char *table = record + table_at(this->fixed_before, n);
+	uint begin = j == 0 ? text_data_at(this->fixed_before, this->text_before, n) : load<u16>(table + (j - 1) * sizeof(u16));
+	uint end = load<u16>(table + j * sizeof(u16));
+	const char *flags = table + this->text_before[n] * sizeof(u16);
+	out_of_line = (flags[j / 8] & (1 << (j % 8))) != 0;
+	size = end - begin;
+	return record + begin;
+}
+
+// Read one column of an offsets-format record of n columns.
+void RowCodec::decode_column(const char *record, uint n, uint column, Value &value, ToastRefs *toasted) const {
+	const Step &step = this->steps[column];
+	if (column >= n) {
+		// older, shorter record--leave the default
+		value = Value();
+		value.data_type = step.data_type;
+	} else if (step.data_type != ColumnAttribute::TEXT) {
+		step.decode(record + sizeof(u16) + this->fixed_before[column], value, column, toasted);
+	} else {
+		uint size;
+		bool out_of_line;
+		const char *in = text_at(record, n, column, size, out_of_line);
+		value.data_type = ColumnAttribute::TEXT;
+		if (out_of_line) {
+			value.s.clear();
+			if (toasted != nullptr)
+				toasted->push_back({column, load<uint32_t>(in), Handle(load<BlockID>(in + 4), load<RecordID>(in + 8))});
+		} else {
+			value.s.assign(in, size);
+		}
+	}
+}
+
+void RowCodec::decode(RecordView data, ValueTuple &row, ToastRefs *toasted, const ColumnOrdinals *columns) const {
+	row.resize(this->steps.size());
+	if (this->format == FORMAT_OFFSETS) {
+		const char *record = data.get_data();
+		uint n = columns_in(data);
+		if (columns == nullptr) {
+			for (uint i = 0; i < this->steps.size(); i++)
+				decode_column(record, n, i, row[i], toasted);
+		} else {
+			for (uint column: *columns)
+				decode_column(record, n, column, row[column], toasted);
+		}
+		return;
+	}
+
+	const char *in = data.get_data();
+	const char *end = in + data.get_size();
+	uint last = (uint)this->steps.size();
+	if (columns != nullptr) {
+		last = 0;
+		for (uint column: *columns)
+			last = max(last, column + 1);
+	}
+	for (uint i = 0; i < last; i++) {
+		bool wanted = columns == nullptr || find(columns->begin(), columns->end(), i) != columns->end();
+		if (in >= end) {
+			// older, shorter record--leave the default
+			if (wanted) {
+				row[i] = Value();
+				row[i].data_type = this->steps[i].data_type;
+			}
+		} else if (wanted) {
+			in = this->steps[i].decode(in, row[i], i, toasted);
+		} else {
+			in = this->steps[i].skip(in, i, nullptr);
+		}
+	}
+}
+
+bool RowCodec::append(RecordView data, const ColumnOrdinals &columns, Handle handle, ColumnBatch &batch) const {
+	if (this->format != FORMAT_OFFSETS)
+		return false;
+	const char *record = data.get_data();
+	uint n = columns_in(data);
+	uint size;
+	bool out_of_line;
+	for (uint column: columns) {
+		if (column < n && this->steps[column].data_type == ColumnAttribute::TEXT) {
+			text_at(record, n, column, size, out_of_line);
+			if (out_of_line)
+				return false;
+		}
+	}
+
+	batch.add_row(handle);
+	for (uint i = 0; i < columns.size(); i++) {
+		uint column = columns[i];
+		ColumnBatch::Column &values = batch.column(i);
+		if (values.data_type == ColumnAttribute::TEXT) {
+			if (column < n) {
+				const char *in = text_at(record, n, column, size, out_of_line);
+				values.bytes.append(in, size);
+			}
+			values.offsets.push_back((uint32_t)values.bytes.size());
+		} else if (column >= n) {
+			values.ints.push_back(0);  // older, shorter record--the default
+		} else if (values.data_type == ColumnAttribute::INT) {
+			values.ints.push_back(load<int32_t>(record + sizeof(u16) + this->fixed_before[column]));
+		} else {
+			values.ints.push_back(*(const uint8_t*)(record + sizeof(u16) + this->fixed_before[column]));
+		}
+	}
+	return true;
+}
+
+// Read one column of a record of a PAX block.
+void RowCodec::decode_column(const PaxPage &page, RecordID record_id, uint column, Value &value, ToastRefs *toasted) const {
+	const Step &step = this->steps[column];
+	if (step.data_type != ColumnAttribute::TEXT) {
+		const char *in = page.fixed(record_id, column);
+		if (in != nullptr) {
+			step.decode(in, value, column, toasted);
+			return;
+		}
+	} else {
+		uint size;
+		bool out_of_line;
+		const char *in = page.text(record_id, column, size, out_of_line);
+		if (in != nullptr) {
+			value.data_type = ColumnAttribute::TEXT;
+			if (out_of_line) {
+				value.s.clear();
+				if (toasted != nullptr)
+					toasted->push_back({column, load<uint32_t>(in), Handle(load<BlockID>(in + 4), load<RecordID>(in + 8))});
+			} else {
+				value.s.assign(in, size);
+			}
+			return;
+		}
+	}
+	// block laid out before the column was added--leave the default
+	value = Value();
+	value.data_type = step.data_type;
+}
+
+void RowCodec::decode(const PaxPage &page, RecordID record_id, ValueTuple &row, ToastRefs *toasted,
+					  const ColumnOrdinals *columns) const {
+	row.resize(this->steps.size());
+	if (columns == nullptr) {
+		for (uint i = 0; i < this->steps.size(); i++)
+			decode_column(page, record_id, i, row[i], toasted);
+	} else {
+		for (uint column: *columns)
+			decode_column(page, record_id, column, row[column], toasted);
+	}
+}
+
+bool RowCodec::append(const PaxPage &page, RecordID record_id, const ColumnOrdinals &columns, Handle handle,
+					  ColumnBatch &batch) const {
+	uint size;
+	bool out_of_line;
+	for (uint column: columns) {
+		if (this->steps[column].data_type == ColumnAttribute::TEXT) {
+			page.text(record_id, column, size, out_of_line);
+			if (out_of_line)
+				return false;
+		}
+	}
+
+	batch.add_row(handle);
+	for (uint i = 0; i < columns.size(); i++) {
+		uint column = columns[i];
+		ColumnBatch::Column &values = batch.column(i);
+		if (values.data_type == ColumnAttribute::TEXT) {
+			const char *in = page.text(record_id, column, size, out_of_line);
+			if (in != nullptr)
+				values.bytes.append(in, size);
+			values.offsets.push_back((uint32_t)values.bytes.size());
+			continue;
+		}
+		const char *in = page.fixed(record_id, column);
+		if (in == nullptr)
+			values.ints.push_back(0);  // block laid out before the column was added--the default
+		else if (values.data_type == ColumnAttribute::INT)
+			values.ints.push_back(load<int32_t>(in));
+		else
+			values.ints.push_back(*(const uint8_t*)in);
+	}
+	return true;
+}
+
+ToastRefs RowCodec::toasted(RecordView data) const {
+	ToastRefs toasted;
+	if (this->format == FORMAT_OFFSETS) {
+		uint n = columns_in(data);
+		for (uint i = 0; i < n; i++) {
+			if (this->steps[i].data_type != ColumnAttribute::TEXT)
+				continue;
+			uint size;
+			bool out_of_line;
+			const char *in = text_at(data.get_data(), n, i, size, out_of_line);
+			if (out_of_line)
+				toasted.push_back({i, load<uint32_t>(in), Handle(load<BlockID>(in + 4), load<RecordID>(in + 8))});
+		}
+		return toasted;
+	}
+	const char *in = data.get_data();
+	const char *end = in + data.get_size();
+	for (uint i = 0; i < this->steps.size() && in < end; i++)
+		in = this->steps[i].skip(in, i, &toasted);
+	return toasted;
+}
+
+RowPredicate::RowPredicate(const RowCodec &codec, const ColumnOrdinals &ordinals, const ValueTuple &values)
+		: codec(codec), ordinals(ordinals), values(values), term_of(), terms() {
+	for (uint i = 0; i < ordinals.size(); i++) {
+		uint column = ordinals[i];
+		if (column >= codec.steps.size())
+			throw DbRelationError("no column " + to_string(column) + " to test");
+		const RowCodec::Step &step = codec.steps[column];
+		const Value &value = values[i];
+		Value default_value;
+		default_value.data_type = step.data_type;
+
+		Term term;
+		term.column = column;
+		term.value = i;
+		term.possible = value.data_type == step.data_type;
+		term.size = (uint32_t)value.s.length();
+		term.matches_default = value == default_value;
+		if (term.possible && !(step.data_type == ColumnAttribute::TEXT && value.s.length() >= RowCodec::TOAST_POINTER)) {
+			const Handle *no_chunks = nullptr;
+			term.bytes.resize(step.size(value, UINT32_MAX));
+			step.encode(&term.bytes[0], value, UINT32_MAX, no_chunks);
+		}
+
+		if (column >= this->term_of.size())
+			this->term_of.resize(column + 1, -1);
+		int t = this->term_of[column];
+		if (t < 0) {
+			this->term_of[column] = (int)this->terms.size();
+			this->terms.push_back(term);
+		} else if (this->values[this->terms[t].value] != value) {
+			// the same column tested for two different values
+			this->terms[t].possible = false;
+			this->terms[t].matches_default = false;
+		}
+	}
+}
+
+RowPredicate::Result RowPredicate::test(RecordView data) const {
+	if (this->codec.format == RowCodec::FORMAT_OFFSETS)
+		return test_offsets(data);
+	return test_inline(data);
+}
+
+RowPredicate::Result RowPredicate::test_inline(RecordView data) const {
+	const char *in = data.get_data();
+	const char *end = in + data.get_size();
+	Result result = YES;
+	for (uint column = 0; column < this->term_of.size(); column++) {
+		int t = this->term_of[column];
+		if (in >= end) {
+			// older, shorter record--the column has its default
+			if (t >= 0 && !this->terms[t].matches_default)
+				return NO;
+			continue;
+		}
+		const RowCodec::Step &step = this->codec.steps[column];
+		if (t >= 0) {
+			const Term &term = this->terms[t];
+			if (!term.possible)
+				return NO;
+			if (step.data_type == ColumnAttribute::TEXT) {
+				u16 size = load<u16>(in);
+				if (size == RowCodec::TOAST_POINTER) {
+					if (load<uint32_t>(in + 2) != term.size)
+						return NO;
+					result = MAYBE;
+				} else if (term.bytes.empty() || size != term.size
+						   || memcmp(in + sizeof(u16), term.bytes.data() + sizeof(u16), size) != 0) {
+					return NO;
+				}
+			} else if (memcmp(in, term.bytes.data(), term.bytes.size()) != 0) {
+				return NO;
+			}
+		}
+		in = step.skip(in, column, nullptr);
+	}
+	return result;
+}
+
+RowPredicate::Result RowPredicate::test_offsets(RecordView data) const {
+	const char *record = data.get_data();
+	uint n = this->codec.columns_in(data);
+	Result result = YES;
+	for (const Term &term: this->terms) {
+		if (term.column >= n) {
+			// older, shorter record--the column has its default
+			if (!term.matches_default)
+				return NO;
+			continue;
+		}
+		if (!term.possible)
+			return NO;
+		if (this->codec.steps[term.column].data_type == ColumnAttribute::TEXT) {
+			uint size;
+			bool out_of_line;
+			const char *in = this->codec.text_at(record, n, term.column, size, out_of_line);
+			if (out_of_line) {
+				if (load<uint32_t>(in) != term.size)
+					return NO;
+				result = MAYBE;
+			} else if (term.bytes.empty() || size != term.size
+					   || memcmp(in, term.bytes.data() + sizeof(u16), size) != 0) {
+				return NO;
+			}
+		} else if (memcmp(record + sizeof(u16) + this->codec.fixed_before[term.column],
+						  term.bytes.data(), term.bytes.size()) != 0) {
+			return NO;
+		}
+	}
+	return result;
+}
+
+RowPredicate::Result RowPredicate::test(const PaxPage &page, RecordID record_id) const {
+	Result result = YES;
+	for (const Term &term: this->terms) {
+		bool text = this->codec.steps[term.column].data_type == ColumnAttribute::TEXT;
+		uint size;
+		bool out_of_line = false;
+		const char *in = text ? page.text(record_id, term.column, size, out_of_line) : page.fixed(record_id, term.column);
+		if (in == nullptr) {
+			// block laid out before the column was added--the column has its default
+			if (!term.matches_default)
+				return NO;
+			continue;
+		}
+		if (!term.possible)
+			return NO;
+		if (text) {
+			if (out_of_line) {
+				if (load<uint32_t>(in) != term.size)
+					return NO;
+				result = MAYBE;
+			} else if (term.bytes.empty() || size != term.size
+					   || memcmp(in, term.bytes.data() + sizeof(u16), size) != 0) {
+				return NO;
+			}
+		} else if (memcmp(in, term.bytes.data(), term.bytes.size()) != 0) {
+			return NO;
+		}
+	}
+	return result;
+}
+
+bool RowPredicate::test(const ValueTuple &row) const {
+	for (uint i = 0; i < this->ordinals.size(); i++)
+		if (row[this->ordinals[i]] != this->values[i])
+			return false;
+	return true;
+}
+
+// test function -- returns true if all tests pass
+bool test_row_codec() {
+	cout << "test_row_codec: " << endl;
+
+	// the codec writes the documented layout and reads back what it wrote
+	ColumnAttributes codec_attributes;
+	codec_attributes.push_back(ColumnAttribute(ColumnAttribute::INT));
+	codec_attributes.push_back(ColumnAttribute(ColumnAttribute::TEXT));
+	codec_attributes.push_back(ColumnAttribute(ColumnAttribute::BOOLEAN));
+	codec_attributes.push_back(ColumnAttribute(ColumnAttribute::TEXT));
+	RowCodec codec(codec_attributes, RowCodec::FORMAT_INLINE);
+	ValueTuple codec_row(4);
+	codec_row[0] = Value(-12);
+	codec_row[1] = Value("hi");
+	codec_row[2].data_type = ColumnAttribute::BOOLEAN;
+	codec_row[2].n = 1;
+	codec_row[3] = Value(string(40, 'z'));  // out of line with a limit of 32
+	Handles codec_chunks;
+	codec_chunks.push_back(Handle(9, 3));
+	if (codec.size(codec_row, 32) != 4 + 4 + 1 + RowCodec::TOAST_POINTER_SZ
+		|| codec.toasting(codec_row, 32) != vector<uint>(1, 3))
+		return false;
+	char codec_bytes[4 + 4 + 1 + RowCodec::TOAST_POINTER_SZ];
+	codec.encode(codec_row, 32, codec_chunks, codec_bytes);
+	const char expected_bytes[] = "\xf4\xff\xff\xff" "\x02\x00hi" "\x01"
+								  "\xff\xff" "\x28\x00\x00\x00" "\x09\x00\x00\x00" "\x03\x00";
+	if (memcmp(codec_bytes, expected_bytes, sizeof(codec_bytes)) != 0)
+		return false;
+
+	// and the offsets format: count, fixed-width values, TEXT end offsets, out-of-line flags, TEXT bytes
+	RowCodec offsets_codec(codec_attributes);
+	if (offsets_codec.get_format() != RowCodec::FORMAT_OFFSETS || offsets_codec.size(codec_row, 32) != 24)
+		return false;
+	char offsets_bytes[24];
+	offsets_codec.encode(codec_row, 32, codec_chunks, offsets_bytes);
+	const char expected_offsets[] = "\x04\x00" "\xf4\xff\xff\xff" "\x01" "\x0e\x00" "\x18\x00" "\x02" "hi"
+									"\x28\x00\x00\x00" "\x09\x00\x00\x00" "\x03\x00";
+	if (memcmp(offsets_bytes, expected_offsets, sizeof(offsets_bytes)) != 0)
+		return false;
+	ColumnAttributes older_attributes(codec_attributes.begin(), codec_attributes.begin() + 2);
+	ValueTuple older_row(codec_row.begin(), codec_row.begin() + 2);
+	char older_bytes[11];
+	RowCodec older_codec(older_attributes);
+	if (older_codec.size(older_row, 32) != sizeof(older_bytes))
+		return false;
+	older_codec.encode(older_row, 32, Handles(), older_bytes);
+
+	// both read back what they wrote, including records from before the last two columns were added
+	for (uint format = RowCodec::FORMAT_INLINE; format <= RowCodec::FORMAT_OFFSETS; format++) {
+		RowCodec &c = format == RowCodec::FORMAT_INLINE ? codec : offsets_codec;
+		RecordView codec_record = format == RowCodec::FORMAT_INLINE ? RecordView(codec_bytes, sizeof(codec_bytes))
+																	: RecordView(offsets_bytes, sizeof(offsets_bytes));
+		RecordView short_record = format == RowCodec::FORMAT_INLINE ? RecordView(codec_bytes, 8)
+																	: RecordView(older_bytes, sizeof(older_bytes));
+		ValueTuple decoded;
+		ToastRefs refs;
+		c.decode(codec_record, decoded, &refs);
+		if (decoded.size() != 4 || decoded[0] != codec_row[0] || decoded[1] != codec_row[1] || decoded[2].n != 1
+			|| !decoded[3].s.empty() || refs.size() != 1 || refs[0].column != 3 || refs[0].size != 40
+			|| refs[0].chunk != Handle(9, 3) || c.toasted(codec_record).size() != 1)
+			return false;
+		c.decode(short_record, decoded);
+		if (decoded[1] != codec_row[1] || decoded[2].n != 0 || decoded[3].data_type != ColumnAttribute::TEXT
+			|| !c.toasted(short_record).empty())
+			return false;
+		ValueTuple partial(4, Value(7));
+		ColumnOrdinals wanted_columns(1, 1);
+		refs.clear();
+		c.decode(codec_record, partial, &refs, &wanted_columns);
+		if (partial[0] != Value(7) || partial[1] != codec_row[1] || partial[3] != Value(7) || !refs.empty())
+			return false;
+		ColumnBatch codec_batch;
+		codec_batch.reset(ColumnAttributes({codec_attributes[2], codec_attributes[1]}));
+		ColumnOrdinals batch_columns({2, 1});
+		ColumnOrdinals toasted_column(1, 3);
+		if (c.append(codec_record, batch_columns, Handle(1, 1), codec_batch) != (format == RowCodec::FORMAT_OFFSETS)
+			|| c.append(codec_record, toasted_column, Handle(1, 1), codec_batch))
+			return false;
+		if (format == RowCodec::FORMAT_OFFSETS
+			&& (!c.append(short_record, batch_columns, Handle(1, 2), codec_batch) || codec_batch.size() != 2
+				|| codec_batch.get(0, 0).data_type != ColumnAttribute::BOOLEAN || codec_batch.get(0, 0).n != 1
+				|| codec_batch.get(1, 0) != codec_row[1]
+				|| codec_batch.get(0, 1).n != 0 || codec_batch.get(1, 1) != codec_row[1]))
+			return false;
+
+		ValueTuple wanted(1);
+		ColumnOrdinals tested(1);
+		wanted[0] = Value(-12);
+		if (RowPredicate(c, tested, wanted).test(codec_record) != RowPredicate::YES)
+			return false;
+		tested[0] = 1;
+		wanted[0] = Value("ho");
+		if (RowPredicate(c, tested, wanted).test(codec_record) != RowPredicate::NO)
+			return false;
+		tested[0] = 2;
+		wanted[0] = Value(1);  // INT isn't BOOLEAN
+		if (RowPredicate(c, tested, wanted).test(codec_record) != RowPredicate::NO)
+			return false;
+		wanted[0].data_type = ColumnAttribute::BOOLEAN;
+		if (RowPredicate(c, tested, wanted).test(codec_record) != RowPredicate::YES
+			|| RowPredicate(c, tested, wanted).test(short_record) != RowPredicate::NO)
+			return false;
+		tested[0] = 3;
+		wanted[0] = Value(string(40, 'z'));
+		if (RowPredicate(c, tested, wanted).test(codec_record) != RowPredicate::MAYBE)
+			return false;
+		tested.push_back(1);
+		wanted.push_back(Value("hi"));
+		wanted[0] = Value(string(39, 'z'));
+		if (RowPredicate(c, tested, wanted).test(codec_record) != RowPredicate::NO)
+			return false;
+		wanted[0] = Value("");
+		if (RowPredicate(c, tested, wanted).test(short_record) != RowPredicate::YES)
+			return false;
+	}
+	cout << "row codec ok" << endl;
+	return true;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file row_codec.h - HeapTable record format, specialized for a table's column list.
+ * ColumnCodec
+ * RowCodec
+ * RowPredicate
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <vector>
+#include "storage_engine.h"
+
+/**
+ * A TEXT value that is kept out of line (in the table's toast file) rather than in its record.
+ */
+struct ToastRef {
+	uint column;     // ordinal of the column in the table
+	uint32_t size;   // length of the value
+	Handle chunk;    // first chunk of the value in the toast file
+};
+typedef std::vector<ToastRef> ToastRefs;
+
+class PaxPage;
+
+/**
+ * @class ColumnCodec - how one column of a given data type is laid out in an inline-format record.
+ *
+ * Specialized for each data type:
+ *      INT:     4 bytes
+ *      TEXT:    2-byte length, then the bytes; or, if the value is out of line, a
+ *               TOAST_POINTER_SZ-byte pointer (see HeapTable) starting with TOAST_POINTER
+ *      BOOLEAN: 1 byte
+ * Each specialization has the same static members:
+ *      WIDTH                                  bytes the value always takes (0 if it varies)
+ *      size(value, toast_limit)               bytes the value will take in the record
+ *      encode(out, value, toast_limit, chunk) write the value (an out-of-line value takes the next chunk)
+ *      decode(in, value, column, toasted)     read a value (an out-of-line value is noted in toasted, if given)
+ *      skip(in)                               step over a value
+ * where encode, decode and skip return the position just past the value.
+ * Fixed-width values are laid out the same way in the offsets format.
+ */
+template <ColumnAttribute::DataType T>
+struct ColumnCodec;
+
+/**
+ * @class RowCodec - encodes and decodes the records of one table.
+ *
+ * The table's column list is compiled once, when the codec is made, into a list of
+ * steps taken from the ColumnCodec specializations, so that a row is encoded or decoded
+ * without looking at column types or names. Rows are positional (a ValueTuple in column
+ * order) and are written straight into the space reserved for them in a block.
+ *
+ * Records are in one of two formats, whichever the table's file was created with:
+ *      FORMAT_INLINE: the original format--each column in turn, as laid out by ColumnCodec.
+ *          Getting to a column means stepping over all the ones before it.
+ *      FORMAT_OFFSETS: fixed-width columns first, then an offset table for the TEXT columns.
+ *          Bytes 0x00 - 0x01: number of columns, n, the record was written with
+ *          then the INT and BOOLEAN values of the first n columns, in column order
+ *          then for each of the t TEXT columns among them, the 2-byte offset (from the start
+ *              of the record) of the end of its value
+ *          then (t + 7) / 8 bytes of flags: bit j is set if TEXT value j is out of line
+ *          then the TEXT values' bytes, in column order; an out-of-line value is instead
+ *              its length (4 bytes), block id (4) and record id (2) of its first chunk
+ *          Where any column is comes straight from the column list and at most two offsets.
+ *
+ * A record with fewer columns than the column list (written before columns were added)
+ * decodes with the missing columns left at their defaults.
+ * Records of a PaxPage (which keeps offsets-format records a column at a time) are read where
+ * each value sits in its minipage rather than put back together first.
+ */
+class RowCodec {
+public:
+	static const uint16_t TOAST_POINTER = 0xFFFF;  // never a valid inline length
+	static const uint TOAST_POINTER_SZ = 12;
+	static const uint TOAST_REF_SZ = 10;  // out-of-line value in the offsets format
+
+	static const uint FORMAT_INLINE = 1;
+	static const uint FORMAT_OFFSETS = 2;
+	static const uint CURRENT_FORMAT = FORMAT_OFFSETS;  // for new files
+
+	RowCodec(const ColumnAttributes &column_attributes, uint format=CURRENT_FORMAT);
+	virtual ~RowCodec() {}
+
+	/**
+	 * Switch to the given record format (0 is taken as FORMAT_INLINE, the format of files
+	 * made before formats were recorded).
+	 */
+	virtual void set_format(uint format);
+	uint get_format() const { return format; }
+
+	/**
+	 * Number of bytes the row's record takes.
+	 * @param row          one value per column, in column order
+	 * @param toast_limit  TEXT values longer than this are out of line
+	 */
+	virtual uint size(const ValueTuple &row, uint toast_limit) const;
+
+	/**
+	 * Which of the row's values go out of line.
+	 * @returns  column ordinals, in column order
+	 */
+	virtual std::vector<uint> toasting(const ValueTuple &row, uint toast_limit) const;
+
+	/**
+	 * Write the row's record.
+	 * @param out     where the record goes, with room for size(row, toast_limit) bytes
+	 * @param chunks  first toast chunk of each out-of-line value, in column order
+	 */
+	virtual void encode(const ValueTuple &row, uint toast_limit, const Handles &chunks, char *out) const;
+
+	/**
+	 * Read a record into row (resized to one value per column).
+	 * Out-of-line values are left empty; they are listed in toasted, if given, to be fetched by the caller.
+	 * @param columns  if given, only these columns are decoded (the rest of row is left as it was)
+	 */
+	virtual void decode(RecordView data, ValueTuple &row, ToastRefs *toasted=nullptr,
+						const ColumnOrdinals *columns=nullptr) const;
+
+	/**
+	 * Add a record's values for the given columns to a batch, as one more row, straight from its bytes.
+	 * That's only done for records in the offsets format with the wanted values inline.
+	 * @param columns  the table column for each of the batch's columns
+	 * @returns        false (leaving batch alone) if it can't be done; the caller decodes the row instead
+	 */
+	virtual bool append(RecordView data, const ColumnOrdinals &columns, Handle handle, ColumnBatch &batch) const;
+
+	/**
+	 * decode() and append() for a record of a PAX block.
+	 */
+	virtual void decode(const PaxPage &page, RecordID record_id, ValueTuple &row, ToastRefs *toasted=nullptr,
+						const ColumnOrdinals *columns=nullptr) const;
+	virtual bool append(const PaxPage &page, RecordID record_id, const ColumnOrdinals &columns, Handle handle,
+						ColumnBatch &batch) const;
+
+	/**
+	 * Out-of-line values of a record, without decoding the rest of it.
+	 */
+	virtual ToastRefs toasted(RecordView data) const;
+
+	uint column_count() const { return (uint)steps.size(); }
+
+protected:
+	friend class RowPredicate;
+
+	typedef uint (*SizeFn)(const Value &value, uint toast_limit);
+	typedef char* (*EncodeFn)(char *out, const Value &value, uint toast_limit, const Handle *&chunk);
+	typedef const char* (*DecodeFn)(const char *in, Value &value, uint column, ToastRefs *toasted);
+	typedef const char* (*SkipFn)(const char *in, uint column, ToastRefs *toasted);
+
+	struct Step {
+		ColumnAttribute::DataType data_type;
+		uint width;
+		SizeFn size;
+		EncodeFn encode;
+		DecodeFn decode;
+		SkipFn skip;
+	};
+	std::vector<Step> steps;
+	uint format;
+	std::vector<uint> fixed_before;  // [i]: bytes of fixed-width values of the columns before column i
+	std::vector<uint> text_before;   // [i]: number of TEXT columns before column i
+
+	template <ColumnAttribute::DataType T>
+	static Step step();
+
+	void decode_column(const char *record, uint n, uint column, Value &value, ToastRefs *toasted) const;
+	void decode_column(const PaxPage &page, RecordID record_id, uint column, Value &value, ToastRefs *toasted) const;
+	const char* text_at(const char *record, uint n, uint column, uint &size, bool &out_of_line) const;
+	uint columns_in(RecordView data) const;
+};
+
+/**
+ * @class RowPredicate - a conjunction of column = value tests (a where clause), compiled against
+ * a RowCodec's layout so that it can be checked on a record's bytes where they sit in the block.
+ *
+ * Each wanted value is encoded once, up front, the way it would appear in a record. Testing a
+ * record then finds the tested columns (in the offsets format, directly; in the inline format,
+ * by stepping over the columns before and between them) and compares bytes; nothing is decoded
+ * or allocated. Whether an out-of-line value matches can't be told from the
+ * record (beyond its length), so such a test comes out MAYBE; the caller then decodes the row,
+ * fetching the value, and uses test(row). The outcome is always the same as comparing decoded
+ * Values with ==, including for records shorter than the column list and for values of the
+ * wrong data type (which never match).
+ */
+class RowPredicate {
+public:
+	enum Result {
+		NO,
+		YES,
+		MAYBE  // depends on an out-of-line value
+	};
+
+	/**
+	 * @param codec     layout of the records to test (must outlive the predicate)
+	 * @param ordinals  columns to test
+	 * @param values    value wanted for each of those columns
+	 */
+	RowPredicate(const RowCodec &codec, const ColumnOrdinals &ordinals, const ValueTuple &values);
+	virtual ~RowPredicate() {}
+
+	/**
+	 * Test a record's bytes.
+	 */
+	virtual Result test(RecordView data) const;
+
+	/**
+	 * Test a record of a PAX block, looking only at the tested columns' minipages.
+	 */
+	virtual Result test(const PaxPage &page, RecordID record_id) const;
+
+	/**
+	 * Test a decoded row (one value per column, with out-of-line values fetched).
+	 */
+	virtual bool test(const ValueTuple &row) const;
+
+	const ColumnOrdinals& get_ordinals() const { return ordinals; }
+
+protected:
+	struct Term {
+		uint column;
+		uint value;           // index of the wanted value in values
+		std::string bytes;    // the value as encoded in a record (empty if it can't be inline)
+		uint32_t size;        // for TEXT, the value's length (to check against an out-of-line value's)
+		bool possible;        // false if no value of the column can match (wrong data type)
+		bool matches_default; // whether a record too short to have the column matches
+	};
+
+	const RowCodec &codec;
+	ColumnOrdinals ordinals;
+	ValueTuple values;
+	std::vector<int> term_of;  // for each column up to the last one tested, index of its term or -1
+	std::vector<Term> terms;
+
+	Result test_inline(RecordView data) const;
+	Result test_offsets(RecordView data) const;
+};
+
+bool test_row_codec();
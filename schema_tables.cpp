@@ -5,6 +5,7 @@
 */
 #include "schema_tables.h"
 #include "ParseTreeToString.h"
+#include "column_table.h"
 
 
 void initialize_schema_tables() {
@@ -40,6 +41,30 @@ bool is_acceptable_data_type(std::string dt) {
 	return dt == "INT" || dt == "TEXT" || dt == "BOOLEAN";  // for now
 }
 
+// Page size recorded in a catalog row (rows written before we recorded it have 0).
+uint page_size_of(ValueDict* row) {
+	int32_t page_size = (*row)["page_size"].n;
+	return page_size > 0 ? (uint)page_size : DbBlock::BLOCK_SZ;
+}
+
+// Fill in the default page size if the caller left it out.
+ValueDict with_page_size(const ValueDict* row) {
+	ValueDict full_row(*row);
+	if (full_row.find("page_size") == full_row.end())
+		full_row["page_size"] = Value((int32_t)DbBlock::BLOCK_SZ);
+	return full_row;
+}
+
+// Storage backend recorded in a _tables row (rows written before we recorded it are Berkeley DB).
+HeapTable::Storage storage_of(ValueDict* row) {
+	return (*row)["storage"].s == "MMAP" ? HeapTable::MMAP : HeapTable::BERKELEY_DB;
+}
+
+// Block layout for a HeapTable per a _tables row: PAX storage is Berkeley DB with PAX blocks.
+HeapTable::Layout layout_of(ValueDict* row) {
+	return (*row)["storage"].s == "PAX" ? HeapTable::PAX : HeapTable::SLOTTED;
+}
+
 
 /*
 * ***************************
@@ -53,8 +78,11 @@ std::map<Identifier, DbRelation*> Tables::table_cache;
 // get the column name for _tables column
 ColumnNames& Tables::COLUMN_NAMES() {
 	static ColumnNames cn;
-	if (cn.empty())
+	if (cn.empty()) {
 		cn.push_back("table_name");
+		cn.push_back("page_size");
+		cn.push_back("storage");
+	}
 	return cn;
 }
 
@@ -62,13 +90,14 @@ ColumnNames& Tables::COLUMN_NAMES() {
 ColumnAttributes& Tables::COLUMN_ATTRIBUTES() {
 	static ColumnAttributes cas;
 	if (cas.empty()) {
-		ColumnAttribute ca(ColumnAttribute::TEXT);
-		cas.push_back(ca);
+		cas.push_back(ColumnAttribute(ColumnAttribute::TEXT));
+		cas.push_back(ColumnAttribute(ColumnAttribute::INT));
+		cas.push_back(ColumnAttribute(ColumnAttribute::TEXT));
 	}
 	return cas;
 }
 
-// ctor - we have a fixed table structure of just one column: table_name
+// ctor - we have a fixed table structure: table_name, page_size, storage
 Tables::Tables() : HeapTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES()) {
 	Tables::table_cache[TABLE_NAME] = this;
 	if (Tables::columns_table == nullptr)
@@ -80,6 +109,7 @@ Tables::Tables() : HeapTable(TABLE_NAME, COLUMN_NAMES(), COLUMN_ATTRIBUTES()) {
 void Tables::create() {
 	HeapTable::create();
 	ValueDict row;
+	row["page_size"] = Value((int32_t)DbBlock::BLOCK_SZ);
 	row["table_name"] = Value("_tables");
 	insert(&row);
 	row["table_name"] = Value("_columns");
@@ -91,12 +121,17 @@ void Tables::create() {
 // Manually check that table_name is unique.
 Handle Tables::insert(const ValueDict* row) {
 	// Try SELECT * FROM _tables WHERE table_name = row["table_name"] and it should return nothing
-	Handles* handles = select(row);
+	ValueDict where;
+	where["table_name"] = row->at("table_name");
+	Handles* handles = select(&where);
 	bool unique = handles->empty();
 	delete handles;
 	if (!unique)
 		throw DbRelationError(row->at("table_name").s + " already exists");
-	return HeapTable::insert(row);
+	ValueDict full_row = with_page_size(row);
+	if (full_row.find("storage") == full_row.end())
+		full_row["storage"] = Value("BDB");
+	return HeapTable::insert(&full_row);
 }
 
 // Remove a row, but first remove from table cache if there
@@ -144,17 +179,48 @@ void Tables::get_columns(Identifier table_name, ColumnNames &column_names, Colum
 	delete handles;
 }
 
+// Close all the tables in the cache (they stay in it, to be opened again when used).
+void Tables::close_all() {
+	for (auto const& entry : Tables::table_cache)
+		entry.second->close();
+}
+
 // Return a table for given table_name.
 DbRelation& Tables::get_table(Identifier table_name) {
 	// if they are asking about a table we've once constructed, then just return that one
 	if (Tables::table_cache.find(table_name) != Tables::table_cache.end())
 		return  *Tables::table_cache[table_name];
 
-	// otherwise assume it is a HeapTable (for now)
+	// otherwise it is a HeapTable (with PAX blocks if created with storage PAX), or a ColumnTable
+	// if created with storage COLUMN
 	ColumnNames column_names;
 	ColumnAttributes column_attributes;
 	get_columns(table_name, column_names, column_attributes);
-	DbRelation* table = new HeapTable(table_name, column_names, column_attributes);
+
+	// SELECT page_size, storage FROM _tables WHERE table_name = <table_name>
+	uint page_size = DbBlock::BLOCK_SZ;
+	HeapTable::Storage storage = HeapTable::BERKELEY_DB;
+	HeapTable::Layout layout = HeapTable::SLOTTED;
+	bool by_column = false;
+	Tables* tables = (Tables*)Tables::table_cache.at(TABLE_NAME);
+	ValueDict where;
+	where["table_name"] = table_name;
+	Handles* handles = tables->select(&where);
+	if (!handles->empty()) {
+		ValueDict* row = tables->project(handles->front());
+		page_size = page_size_of(row);
+		storage = storage_of(row);
+		layout = layout_of(row);
+		by_column = (*row)["storage"].s == "COLUMN";
+		delete row;
+	}
+	delete handles;
+
+	DbRelation* table;
+	if (by_column)
+		table = new ColumnTable(table_name, column_names, column_attributes, page_size);
+	else
+		table = new HeapTable(table_name, column_names, column_attributes, page_size, storage, layout);
 	Tables::table_cache[table_name] = table;
 	return *table;
 }
@@ -202,6 +268,12 @@ void Columns::create() {
 	row["table_name"] = Value("_tables");
 	row["column_name"] = Value("table_name");
 	insert(&row);
+	row["column_name"] = Value("page_size");
+	row["data_type"] = Value("INT");
+	insert(&row);
+	row["data_type"] = Value("TEXT");
+	row["column_name"] = Value("storage");
+	insert(&row);
 
 	row["table_name"] = Value("_columns");
 	row["column_name"] = Value("table_name");
@@ -57,6 +57,12 @@ public:
 	*/
 	static DbRelation& get_table(Identifier table_name);
 
+	/**
+	* Close every table instantiated so far, writing anything they have held back (a ColumnTable's
+	* last rows, for instance).
+	*/
+	static void close_all();
+
 protected:
 	// hard-coded columns for _tables table
 	static ColumnNames& COLUMN_NAMES();
@@ -8,6 +8,9 @@
 #include <sys/types.h>
 #include "db_cxx.h"
 #include "heap_storage.h"
+#include "int_filter.h"
+#include "column_table.h"
+#include "pax_page.h"
 #include "storage_engine.h"
 #include "SQLExec.h"
 // include the sql parser
@@ -46,9 +49,10 @@ int main(int argc, char *argv[])
   path = argv[1];
 
   //Initialize DBenv flags
-  u_int32_t env_flags = DB_CREATE |    // If the environment does not
-                                       // exist, create it.
-                        DB_INIT_MPOOL; // Initialize the in-memory cache.
+  u_int32_t env_flags = DB_CREATE |     // If the environment does not
+                                        // exist, create it.
+                        DB_INIT_MPOOL | // Initialize the in-memory cache.
+                        DB_THREAD;      // Handles may be used by the buffer pool's flusher thread too.
 
   string envHome(path);
   DbEnv *myEnv = new DbEnv(0U);
@@ -78,11 +82,50 @@ int main(int argc, char *argv[])
 
     if (cmd == "quit")
     {
+      BufferPool::shared().stop_flusher();
+      Tables::close_all();              // tables may hold rows back (ColumnTable)
+      BufferPool::shared().flush_all(); // checkpoint before leaving
       return 0;
     }
     else if (cmd == "test")
     {
       cout << "Testing heap storage: " << test_heap_storage() << endl;
+      cout << "Testing row codec: " << test_row_codec() << endl;
+      cout << "Testing int filters: " << test_int_filter() << endl;
+      cout << "Testing bloom filters: " << test_bloom_filters() << endl;
+      cout << "Testing column table: " << test_column_table() << endl;
+      cout << "Testing pax page: " << test_pax_page() << endl;
+    }
+    else if (cmd == "bench")
+    {
+      benchmark_slotted_page();
+      benchmark_heap_table();
+      benchmark_int_filter();
+    }
+    else if (cmd == "stats")
+    {
+      cout << BufferPool::shared() << endl;
+      cout << "block scans: " << BlockScan::get_blocks_read() << " blocks read, "
+           << BlockScan::get_blocks_skipped() << " passed over" << endl;
+    }
+    else if (cmd.compare(0, 4, "set ") == 0)
+    {
+      // session options: set page_size N, set storage BDB|MMAP|PAX|COLUMN,
+      // set compaction EAGER|DEFERRED (for tables created from now on),
+      // set flush_interval MS (background write-back of dirty blocks, 0 for none),
+      // set parallelism N (most threads a table scan may use)
+      try
+      {
+        size_t space = cmd.find(' ', 4);
+        string name = cmd.substr(4, space == string::npos ? string::npos : space - 4);
+        string value = space == string::npos ? "" : cmd.substr(space + 1);
+        SQLExec::set_option(name, value);
+        cout << name << " " << value << endl;
+      }
+      catch (exception &e)
+      {
+        cout << "\nError: " << e.what() << endl;
+      }
     }
     else
     {
@@ -1,10 +1,22 @@
 #include <algorithm>
 #include "storage_engine.h"
 
+// Probe with a throwaway handle--Berkeley DB doesn't let a handle be reused after a failed open.
+bool db_file_exists(std::string dbfilename) {
+    Db db(_DB_ENV, 0);
+    try {
+        db.open(nullptr, dbfilename.c_str(), nullptr, DB_UNKNOWN, DB_RDONLY, 0);
+    } catch (DbException& e) {
+        return false;  // the handle is closed by its destructor
+    }
+    db.close(0);
+    return true;
+}
+
 bool Value::operator==(const Value &other) const {
     if (this->data_type != other.data_type)
         return false;
-    if (this->data_type == ColumnAttribute::INT)
+    if (this->data_type == ColumnAttribute::INT || this->data_type == ColumnAttribute::BOOLEAN)
         return this->n == other.n;
     return this->s == other.s;
 }
@@ -28,6 +40,146 @@ ColumnAttributes* DbRelation::get_column_attributes(const ColumnNames &select_co
     return ret;
 }
 
+void ColumnBatch::reset(const ColumnAttributes &column_attributes, uint capacity) {
+    this->capacity = capacity > 0 ? capacity : 1;
+    this->columns.resize(column_attributes.size());
+    for (uint i = 0; i < column_attributes.size(); i++)
+        this->columns[i].data_type = ColumnAttribute(column_attributes[i]).get_data_type();
+    clear();
+}
+
+// Keeps the columns' buffers, so refilling the batch doesn't allocate.
+void ColumnBatch::clear() {
+    for (auto &column: this->columns) {
+        column.ints.clear();
+        column.bytes.clear();
+        column.offsets.assign(1, 0);
+    }
+    this->handles.clear();
+    this->selection.clear();
+}
+
+void ColumnBatch::append(Handle handle, const ValueTuple &row) {
+    add_row(handle);
+    for (uint i = 0; i < this->columns.size(); i++) {
+        Column &column = this->columns[i];
+        if (column.data_type == ColumnAttribute::TEXT) {
+            column.bytes.append(row[i].s);
+            column.offsets.push_back((uint32_t)column.bytes.size());
+        } else {
+            column.ints.push_back(row[i].n);
+        }
+    }
+}
+
+void ColumnBatch::select_all() {
+    this->selection.resize(this->handles.size());
+    for (uint i = 0; i < this->selection.size(); i++)
+        this->selection[i] = i;
+}
+
+Value ColumnBatch::get(uint column, uint row) const {
+    const Column &c = this->columns.at(column);
+    Value value;
+    value.data_type = c.data_type;
+    if (c.data_type == ColumnAttribute::TEXT)
+        value.s.assign(c.bytes, c.offsets.at(row), c.offsets.at(row + 1) - c.offsets[row]);
+    else
+        value.n = c.ints.at(row);
+    return value;
+}
+
+// Find each column's position in column_names
+ColumnOrdinals* DbRelation::get_ordinals(const ColumnNames &select_column_names) const {
+    ColumnOrdinals *ret = new ColumnOrdinals();
+    for (auto const& column_name: select_column_names) {
+        auto it = std::find(this->column_names.begin(), this->column_names.end(), column_name);
+        if (it == this->column_names.end()) {
+            delete ret;
+            throw DbRelationError("table does not have column named '" + column_name + "'");
+        }
+        ret->push_back((uint)(it - this->column_names.begin()));
+    }
+    return ret;
+}
+
+// Ordinals of the keys of a ValueDict (in key order, same as iterating the dictionary)
+ColumnOrdinals* DbRelation::get_ordinals(const ValueDict &select_column_names) const {
+    ColumnNames t;
+    for (auto const& column: select_column_names)
+        t.push_back(column.first);
+    return get_ordinals(t);
+}
+
+// Generic version in terms of the by-name project(); storage engines do better.
+ValueTuple* DbRelation::project(Handle handle, const ColumnOrdinals* ordinals) {
+    ColumnNames t;
+    for (auto ordinal: *ordinals)
+        t.push_back(this->column_names.at(ordinal));
+    ValueDict *row = project(handle, &t);
+    ValueTuple *ret = new ValueTuple();
+    for (auto const& column_name: t)
+        ret->push_back(row->at(column_name));
+    delete row;
+    return ret;
+}
+
+// Generic version: scan, then project each row found (on this thread alone).
+ValueTuples* DbRelation::scan_project(const ValueDict* where, const ColumnOrdinals* ordinals, uint /*parallelism*/) {
+    ValueTuples *ret = new ValueTuples();
+    HandleIterator *rows = scan(where);
+    Handle handle;
+    try {
+        while (rows->next(handle))
+            ret->push_back(project(handle, ordinals));
+    } catch (...) {
+        for (auto row: *ret)
+            delete row;
+        delete ret;
+        delete rows;
+        throw;
+    }
+    delete rows;
+    return ret;
+}
+
+// Generic batch scan: the rows of scan(where), projected one at a time into the batch.
+class DbRelationBatchScan : public ColumnBatchIterator {
+public:
+    DbRelationBatchScan(DbRelation *relation, const ColumnOrdinals *ordinals, const ValueDict *where, uint capacity)
+            : relation(relation), rows(relation->scan(where)), ordinals(*ordinals), attributes(), capacity(capacity) {
+        ColumnAttributes all = relation->get_column_attributes();
+        for (auto ordinal: this->ordinals)
+            this->attributes.push_back(all.at(ordinal));
+    }
+    virtual ~DbRelationBatchScan() {delete rows;}
+    DbRelationBatchScan(const DbRelationBatchScan& other) = delete;
+    DbRelationBatchScan& operator=(const DbRelationBatchScan& other) = delete;
+
+    virtual bool next(ColumnBatch &batch) {
+        batch.reset(this->attributes, this->capacity);
+        Handle handle;
+        while (!batch.full() && this->rows->next(handle)) {
+            ValueTuple *row = this->relation->project(handle, &this->ordinals);
+            batch.append(handle, *row);
+            delete row;
+        }
+        batch.select_all();
+        return batch.size() > 0;
+    }
+
+protected:
+    DbRelation *relation;
+    HandleIterator *rows;
+    ColumnOrdinals ordinals;
+    ColumnAttributes attributes;
+    uint capacity;
+};
+
+ColumnBatchIterator* DbRelation::scan_batches(const ColumnOrdinals* ordinals, const ValueDict* where, uint capacity) {
+    return new DbRelationBatchScan(this, ordinals, where, capacity);
+}
+
 // Just pulls out the column names from a ValueDict and passes that to the usual form of project().
 ValueDict* DbRelation::project(Handle handle, const ValueDict* where) {
     ColumnNames t;
@@ -20,6 +20,13 @@
  */
 extern DbEnv* _DB_ENV;
 
+/**
+ * Check whether a Berkeley DB file exists in _DB_ENV (without disturbing any open handle on it).
+ * @param dbfilename  file name within the environment
+ * @returns           true if the file can be opened
+ */
+bool db_file_exists(std::string dbfilename);
+
 /*
  * Convenient aliases for types
  */
@@ -28,6 +35,73 @@ typedef uint32_t BlockID;
 typedef std::vector<RecordID> RecordIDs;
 typedef std::length_error DbBlockNoRoomError;
 
+/**
+ * @class Iterator - hands out a sequence of items one at a time, without building a list of them.
+ */
+template <typename T>
+class Iterator {
+public:
+	virtual ~Iterator() {}
+
+	/**
+	 * Advance to the next item.
+	 * @param item  set to the next item
+	 * @returns     false (leaving item alone) if there are no more
+	 */
+	virtual bool next(T &item) = 0;
+};
+
+/**
+ * @class VectorIterator - Iterator over a list it owns, for classes that can only build the whole list.
+ */
+template <typename T>
+class VectorIterator : public Iterator<T> {
+public:
+	VectorIterator(std::vector<T> *items) : items(items), i(0) {}
+	virtual ~VectorIterator() {delete items;}
+	VectorIterator(const VectorIterator& other) = delete;
+	VectorIterator(VectorIterator&& temp) = delete;
+	VectorIterator& operator=(const VectorIterator& other) = delete;
+	VectorIterator& operator=(VectorIterator&& temp) = delete;
+
+	virtual bool next(T &item) {
+		if (items == nullptr || i >= items->size())
+			return false;
+		item = (*items)[i++];
+		return true;
+	}
+
+protected:
+	std::vector<T> *items;
+	size_t i;
+};
+
+typedef Iterator<RecordID> RecordIDIterator;
+
+/**
+ * @class RecordView - non-owning look at the bytes of one record inside a block.
+ *
+ * Nothing is copied or allocated; the view is only good while the block it came
+ * from is still alive (for a HeapFile block, while its buffer frame is pinned).
+ * A block that doesn't keep a record's bytes together (PaxPage) puts it back
+ * together in a buffer of its own, so there a view is good only until the next
+ * view() of the same block or a change to it; take a copy to keep two at once.
+ * A default-constructed view is null, e.g., for a deleted record.
+ */
+class RecordView {
+public:
+	RecordView() : data(nullptr), size(0) {}
+	RecordView(const char *data, uint size) : data(data), size(size) {}
+
+	const char* get_data() const {return data;}
+	uint get_size() const {return size;}
+	bool is_null() const {return data == nullptr;}
+
+protected:
+	const char *data;
+	uint size;
+};
+
 /**
  * @class DbBlock - abstract base class for blocks in our database files 
  * (DbBlock's belong to DbFile's.)
@@ -35,6 +109,7 @@ typedef std::length_error DbBlockNoRoomError;
  * Methods for putting/getting records in blocks:
  * 	add(data)
  * 	get(record_id)
+ * 	view(record_id)
  * 	put(record_id, data)
  * 	del(record_id)
  * 	ids()
@@ -46,10 +121,25 @@ typedef std::length_error DbBlockNoRoomError;
 class DbBlock {
 public:
 	/**
-	 * our blocks are 4kB
+	 * our blocks are 4kB unless the file was created with another size
 	 */ 
 	static const uint BLOCK_SZ = 4096;
 
+	/**
+	 * range of block sizes a file may be created with (powers of two)
+	 */
+	static const uint MIN_BLOCK_SZ = 4096;
+	static const uint MAX_BLOCK_SZ = 65536;
+
+	/**
+	 * Check a requested block size.
+	 * @param size  bytes per block
+	 * @returns     true if size is a power of two from MIN_BLOCK_SZ to MAX_BLOCK_SZ
+	 */
+	static bool is_valid_size(uint size) {
+		return size >= MIN_BLOCK_SZ && size <= MAX_BLOCK_SZ && (size & (size - 1)) == 0;
+	}
+
 	/**
 	 * ctor/dtor (subclasses should handle the big-5)
 	 */ 
@@ -71,6 +161,14 @@ public:
 	 */
 	virtual Dbt* get(RecordID record_id) const = 0;
 
+	/**
+	 * Look at a record in place without copying it.
+	 * @param record_id  which record to look at
+	 * @returns          view of the record's bytes in this block (null if deleted); see RecordView
+	 *                   for how long it is good
+	 */
+	virtual RecordView view(RecordID record_id) const = 0;
+
 	/**
 	 * Change the data stored for a record in this block.
 	 * @param record_id  which record to update
@@ -92,6 +190,19 @@ public:
 	 */ 
 	virtual RecordIDs* ids() const = 0;
 
+	/**
+	 * Go through the record ids in this block (excluding deleted ones) without listing them first.
+	 * Records deleted during the iteration are skipped if not yet reached.
+	 * @returns  iterator over the record ids (freed by caller)
+	 */
+	virtual RecordIDIterator* scan_ids() const {return new VectorIterator<RecordID>(ids());}
+
+	/**
+	 * How big a record could be added to this block right now.
+	 * @returns  bytes available for a new record
+	 */
+	virtual uint free_space() const = 0;
+
 	/**
 	 * Access the whole block's memory as a BerkeleyDB Dbt pointer.
 	 * @returns  Dbt used by this block
@@ -116,7 +227,8 @@ protected:
 };
 
 // convenience type alias
-typedef std::vector<BlockID> BlockIDs;  // FIXME: will need to turn this into an iterator at some point
+typedef std::vector<BlockID> BlockIDs;
+typedef Iterator<BlockID> BlockIDIterator;
 
 /**
  * @class DbFile - abstract base class which represents a disk-based collection of DbBlocks
@@ -128,6 +240,7 @@ typedef std::vector<BlockID> BlockIDs;  // FIXME: will need to turn this into an
  *	get(block_id)
  *	put(block)
  *	block_ids()
+ *	scan_block_ids()
  */
 class DbFile {
 public:
@@ -176,11 +289,17 @@ public:
 
 	/**
 	 * Get a list of all the valid BlockID's in the file
-	 * FIXME - not a good long-term approach, but we'll do this until we put in iterators
+	 * (scan_block_ids() does the same without building the list)
 	 * @returns  a pointer to vector of BlockIDs (freed by caller)
 	 */ 
 	virtual BlockIDs* block_ids() const = 0;
 
+	/**
+	 * Go through all the valid BlockID's in the file, one at a time.
+	 * @returns  iterator over the block ids (freed by caller)
+	 */
+	virtual BlockIDIterator* scan_block_ids() const {return new VectorIterator<BlockID>(block_ids());}
+
 protected:
 	std::string name;  // filename (or part of it)
 };
@@ -219,7 +338,7 @@ public:
 
 	Value() : n(0) {data_type = ColumnAttribute::INT;}
 	Value(int32_t n) : n(n) {data_type = ColumnAttribute::INT;}
-	Value(std::string s) : s(s) {data_type = ColumnAttribute::TEXT; }
+	Value(std::string s) : n(0), s(s) {data_type = ColumnAttribute::TEXT; }
 
 	bool operator==(const Value &other) const;
 	bool operator!=(const Value &other) const;
@@ -230,9 +349,94 @@ typedef std::string Identifier;
 typedef std::vector<Identifier> ColumnNames;
 typedef std::vector<ColumnAttribute> ColumnAttributes;
 typedef std::pair<BlockID, RecordID> Handle;
-typedef std::vector<Handle> Handles;  // FIXME: will need to turn this into an iterator at some point
+typedef std::vector<Handle> Handles;
+typedef Iterator<Handle> HandleIterator;
 typedef std::map<Identifier, Value> ValueDict;
 typedef std::vector<ValueDict*> ValueDicts;
+typedef std::vector<Value> ValueTuple;  // values by position, e.g., one per column in the table's column order
+typedef std::vector<ValueTuple*> ValueTuples;
+typedef std::vector<uint> ColumnOrdinals;  // positions of columns in a relation's column list
+
+
+/**
+ * @class ColumnBatch - a run of rows from a relation, held column by column.
+ *
+ * Each batched column keeps its values in one array so that filters and aggregates can be
+ * tight loops over them:
+ *      INT, BOOLEAN: ints[i] is row i's value
+ *      TEXT:         row i's value is bytes[offsets[i] .. offsets[i + 1]) (offsets has one extra entry)
+ * Alongside are the handle each row came from and a selection vector: the rows still in play,
+ * in ascending order. Filling a batch selects all of its rows; filters narrow the selection
+ * rather than moving values around.
+ * A batch is reused from one fill to the next, so its arrays only grow to the capacity once.
+ */
+class ColumnBatch {
+public:
+	static const uint DEFAULT_CAPACITY = 1024;
+
+	struct Column {
+		ColumnAttribute::DataType data_type;
+		std::vector<int32_t> ints;      // INT and BOOLEAN values
+		std::vector<uint32_t> offsets;  // TEXT: where each value starts in bytes, then where the last one ends
+		std::string bytes;              // TEXT: the values, back to back
+	};
+
+	ColumnBatch() : capacity(DEFAULT_CAPACITY), columns(), handles(), selection() {}
+	virtual ~ColumnBatch() {}
+
+	/**
+	 * Empty the batch and set it up for rows of the given columns.
+	 * @param column_attributes  one per batched column
+	 * @param capacity           most rows the batch is to hold
+	 */
+	virtual void reset(const ColumnAttributes &column_attributes, uint capacity=DEFAULT_CAPACITY);
+
+	/**
+	 * Empty the batch, keeping its columns.
+	 */
+	virtual void clear();
+
+	/**
+	 * Add a row.
+	 * @param handle  where the row came from
+	 * @param row     one value per batched column
+	 */
+	virtual void append(Handle handle, const ValueTuple &row);
+
+	/**
+	 * Add a row whose values the caller is about to push onto each column (see Column).
+	 * @returns  the new row's index
+	 */
+	virtual uint add_row(Handle handle) {handles.push_back(handle); return (uint)handles.size() - 1;}
+
+	/**
+	 * Select every row in the batch.
+	 */
+	virtual void select_all();
+
+	/**
+	 * Value of a batched column in one row.
+	 */
+	virtual Value get(uint column, uint row) const;
+
+	uint size() const {return (uint)handles.size();}
+	bool full() const {return handles.size() >= capacity;}
+	uint get_capacity() const {return capacity;}
+	uint column_count() const {return (uint)columns.size();}
+	Column& column(uint i) {return columns[i];}
+	const Column& column(uint i) const {return columns[i];}
+	const Handles& get_handles() const {return handles;}
+	std::vector<uint>& get_selection() {return selection;}
+	const std::vector<uint>& get_selection() const {return selection;}
+
+protected:
+	uint capacity;
+	std::vector<Column> columns;
+	Handles handles;
+	std::vector<uint> selection;
+};
+
+typedef Iterator<ColumnBatch> ColumnBatchIterator;
 
 
 /**
@@ -260,8 +464,11 @@ public:
  *	del(handle)
  *	select()
  *	select(where)
+ *	scan(where)
  *	project(handle)
  *	project(handle, column_names)
+ *	project(handle, ordinals)
+ *	get_ordinals(column_names)
  */
 class DbRelation {
 public:
@@ -345,6 +552,35 @@ public:
 	 */
 	virtual Handles* select(Handles* current_selection, const ValueDict* where) = 0;
 
+	/**
+	 * Like select(where), but hands out the qualifying rows as they are found instead of
+	 * collecting them all first, so memory use doesn't grow with the size of the table.
+	 * @param where  where-clause predicates (nullptr for all rows)
+	 * @returns      iterator over handles for qualifying rows (freed by caller)
+	 */
+	virtual HandleIterator* scan(const ValueDict* where=nullptr) {return new VectorIterator<Handle>(select(where));}
+
+	/**
+	 * Conceptually, execute: SELECT <ordinals> FROM <table_name> WHERE <where>
+	 * The qualifying rows come back projected, in the order scan(where) would find them.
+	 * @param where        where-clause predicates (nullptr for all rows)
+	 * @param ordinals     columns to project
+	 * @param parallelism  most threads the relation may use to do it
+	 * @returns            projected rows (caller frees each row and the list)
+	 */
+	virtual ValueTuples* scan_project(const ValueDict* where, const ColumnOrdinals* ordinals, uint parallelism=1);
+
+	/**
+	 * Like scan(where), but hands out the qualifying rows a ColumnBatch at a time, with the
+	 * given columns in it. Each call to next() refills the batch given (and selects all of it).
+	 * @param ordinals  columns to batch
+	 * @param where     where-clause predicates (nullptr for all rows)
+	 * @param capacity  most rows in a batch
+	 * @returns         iterator over batches (freed by caller)
+	 */
+	virtual ColumnBatchIterator* scan_batches(const ColumnOrdinals* ordinals, const ValueDict* where=nullptr,
+											  uint capacity=ColumnBatch::DEFAULT_CAPACITY);
+
 	/**
 	 * Return a sequence of all values for handle (SELECT *).
 	 * @param handle  row to get values from
@@ -370,6 +606,16 @@ public:
 	 */
 	virtual ValueDict* project(Handle handle, const ValueDict* column_names);
 
+	/**
+	 * Return the values for handle at the given column positions (as from get_ordinals),
+	 * without looking anything up by name. Query plans resolve their columns to ordinals
+	 * once and then use this for every row.
+	 * @param handle    row to get values from
+	 * @param ordinals  positions of the columns to project, in the order wanted
+	 * @returns         tuple of values from row, one for each ordinal (freed by caller)
+	 */
+	virtual ValueTuple* project(Handle handle, const ColumnOrdinals* ordinals);
+
 	// additional versions of project for multiple rows
 	virtual ValueDicts* project(Handles *handles);
 	virtual ValueDicts* project(Handles *handles, const ColumnNames* column_names);
@@ -400,6 +646,15 @@ public:
 	 */
 	virtual ColumnAttributes* get_column_attributes(const ColumnNames &select_column_names) const;
 
+	/**
+	 * Positions of the given columns in this relation's column list.
+	 * @param select_column_names  list of column names (or the keys of a dictionary)
+	 * @returns                    ordinals, in the same order (freed by caller)
+	 * @throws                     DbRelationError if a column isn't in the relation
+	 */
+	virtual ColumnOrdinals* get_ordinals(const ColumnNames &select_column_names) const;
+	virtual ColumnOrdinals* get_ordinals(const ValueDict &select_column_names) const;
+
 protected:
 	Identifier table_name;
 	ColumnNames column_names;
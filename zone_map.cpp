@@ -0,0 +1,115 @@
+/**
+ * @file zone_map.cpp - implementation of:
+ * AllFilters
+ * ZoneMap
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#include <limits>
+#include "zone_map.h"
+using namespace std;
+
+AllFilters::~AllFilters() {
+	for (auto filter: this->filters)
+		delete filter;
+}
+
+bool AllFilters::wanted(BlockID block_id) const {
+	for (auto filter: this->filters)
+		if (!filter->wanted(block_id))
+			return false;
+	return true;
+}
+
+/**
+ * @class ZoneFilter - the blocks of a ZoneMap that may have rows with given values.
+ */
+class ZoneFilter : public BlockFilter {
+public:
+	ZoneFilter(const ZoneMap &zones, const ColumnOrdinals &columns, const vector<int32_t> &values)
+			: zones(zones), columns(columns), values(values) {}
+	virtual ~ZoneFilter() {}
+
+	virtual bool wanted(BlockID block_id) const {
+		for (uint i = 0; i < this->columns.size(); i++)
+			if (!this->zones.may_contain(block_id, this->columns[i], this->values[i], this->values[i]))
+				return false;
+		return true;
+	}
+
+protected:
+	const ZoneMap &zones;
+	ColumnOrdinals columns;
+	vector<int32_t> values;  // wanted value of each column, as summarized
+};
+
+ZoneMap::ZoneMap(const ColumnAttributes &column_attributes) : data_types(), columns(), slot_of(), zones(),
+		built(false) {
+	for (auto attribute: column_attributes) {
+		ColumnAttribute::DataType data_type = attribute.get_data_type();
+		this->data_types.push_back(data_type);
+		if (data_type == ColumnAttribute::INT || data_type == ColumnAttribute::BOOLEAN) {
+			this->slot_of.push_back((int)this->columns.size());
+			this->columns.push_back((uint)this->data_types.size() - 1);
+		} else {
+			this->slot_of.push_back(-1);
+		}
+	}
+}
+
+void ZoneMap::clear(bool built) {
+	this->zones.clear();
+	this->built = built;
+}
+
+// Grow the map to the block if need be (with empty zones for any blocks skipped over) and widen its zones.
+void ZoneMap::add(BlockID block_id, const ValueTuple &row) {
+	if (!this->built || this->columns.empty() || block_id == 0)
+		return;
+	size_t n = this->columns.size();
+	size_t first = (block_id - 1) * n;
+	if (first + n > this->zones.size())
+		this->zones.resize(first + n, Zone{numeric_limits<int32_t>::max(), numeric_limits<int32_t>::min()});
+	for (size_t slot = 0; slot < n; slot++) {
+		uint column = this->columns[slot];
+		int32_t value = column < row.size() ? summary(column, row[column]) : 0;  // a short row has the default
+		Zone &zone = this->zones[first + slot];
+		if (value < zone.low)
+			zone.low = value;
+		if (value > zone.high)
+			zone.high = value;
+	}
+}
+
+bool ZoneMap::may_contain(BlockID block_id, uint column, int32_t low, int32_t high) const {
+	if (!this->built || column >= this->slot_of.size() || this->slot_of[column] < 0 || block_id == 0)
+		return true;
+	size_t i = (block_id - 1) * this->columns.size() + this->slot_of[column];
+	if (i >= this->zones.size())
+		return true;
+	const Zone &zone = this->zones[i];
+	return zone.low <= high && low <= zone.high;
+}
+
+BlockFilter* ZoneMap::filter(const ColumnOrdinals &ordinals, const ValueTuple &values) const {
+	ColumnOrdinals columns;
+	vector<int32_t> wanted;
+	for (uint i = 0; i < ordinals.size(); i++) {
+		uint column = ordinals[i];
+		if (column < this->slot_of.size() && this->slot_of[column] >= 0
+			&& values[i].data_type == this->data_types[column]) {
+			columns.push_back(column);
+			wanted.push_back(summary(column, values[i]));
+		}
+	}
+	if (columns.empty())
+		return nullptr;
+	return new ZoneFilter(*this, columns, wanted);
+}
+
+// A value as it is compared in the record: BOOLEANs are kept as a byte.
+int32_t ZoneMap::summary(uint column, const Value &value) const {
+	if (this->data_types[column] == ColumnAttribute::BOOLEAN)
+		return (uint8_t)value.n;
+	return value.n;
+}
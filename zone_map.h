@@ -0,0 +1,123 @@
+/**
+ * @file zone_map.h - per-block summaries of a table's values, for passing over blocks in a scan.
+ * BlockFilter
+ * AllFilters
+ * ZoneMap
+ *
+ * @see "Seattle University, CPSC5300, Summer 2018"
+ */
+#pragma once
+
+#include <vector>
+#include "storage_engine.h"
+
+/**
+ * @class BlockFilter - which blocks of a file a scan has to read.
+ *
+ * A block the filter doesn't want can't have anything in it the scan is looking for, so
+ * the scan goes past it without reading it. Unsure answers must be "wanted".
+ */
+class BlockFilter {
+public:
+	virtual ~BlockFilter() {}
+
+	/**
+	 * @returns  false only if nothing in the block can be of use
+	 */
+	virtual bool wanted(BlockID block_id) const = 0;
+};
+
+/**
+ * @class AllFilters - wants a block only if each of its filters does.
+ */
+class AllFilters : public BlockFilter {
+public:
+	/**
+	 * @param filters  freed with this
+	 */
+	AllFilters(const std::vector<BlockFilter*> &filters) : filters(filters) {}
+	virtual ~AllFilters();
+	AllFilters(const AllFilters& other) = delete;
+	AllFilters(AllFilters&& temp) = delete;
+	AllFilters& operator=(const AllFilters& other) = delete;
+	AllFilters& operator=(AllFilters&& temp) = delete;
+
+	virtual bool wanted(BlockID block_id) const;
+
+protected:
+	std::vector<BlockFilter*> filters;
+};
+
+/**
+ * @class ZoneMap - lowest and highest value of each INT and BOOLEAN column in each block of a table.
+ *
+ * Kept in memory by the table: built with one pass over its blocks the first time a scan can
+ * use it (see HeapTable), then widened as rows are added. Deleting rows leaves the ranges as
+ * they were, so they can be wider than the rows left in a block but never narrower; a block
+ * whose range for a column leaves out a value has no row with that value. Blocks past the
+ * ones known to the map (or any block, before the map is built) are always wanted.
+ * BOOLEAN values are summarized as the byte kept in the record.
+ */
+class ZoneMap {
+public:
+	/**
+	 * @param column_attributes  the table's columns (the INT and BOOLEAN ones are summarized)
+	 */
+	ZoneMap(const ColumnAttributes &column_attributes);
+	virtual ~ZoneMap() {}
+	ZoneMap(const ZoneMap& other) = delete;
+	ZoneMap(ZoneMap&& temp) = delete;
+	ZoneMap& operator=(const ZoneMap& other) = delete;
+	ZoneMap& operator=(ZoneMap&& temp) = delete;
+
+	/**
+	 * Forget all the blocks.
+	 * @param built  true if the table is known to be empty (so the map is already complete)
+	 */
+	virtual void clear(bool built=false);
+
+	/**
+	 * Widen a block's ranges to take in a row (ignored until the map is built).
+	 * @param row  one value per column, in column order (as many as there are, for a row short of columns)
+	 */
+	virtual void add(BlockID block_id, const ValueTuple &row);
+
+	/**
+	 * Note that the map now covers every block (until the next clear()).
+	 */
+	virtual void set_built() { built = true; }
+	bool is_built() const { return built; }
+
+	/**
+	 * Check if a block may have a value between low and high (inclusive) in a column.
+	 * @param column  ordinal of the column in the table (true for one that isn't summarized)
+	 */
+	virtual bool may_contain(BlockID block_id, uint column, int32_t low, int32_t high) const;
+
+	/**
+	 * A filter wanting just the blocks that may have rows with all the given values. Only
+	 * the values for summarized columns (of the column's data type) play a part.
+	 * @returns  the filter (freed by caller; uses this map, so must not outlive it), or nullptr
+	 *           if none of the values can rule out a block
+	 */
+	virtual BlockFilter* filter(const ColumnOrdinals &ordinals, const ValueTuple &values) const;
+
+	/**
+	 * Columns that are summarized, in column order.
+	 */
+	const ColumnOrdinals& get_columns() const { return columns; }
+
+protected:
+	struct Zone {
+		int32_t low;
+		int32_t high;  // less than low for a block with no rows
+	};
+
+	std::vector<ColumnAttribute::DataType> data_types;  // of each column in the table
+	ColumnOrdinals columns;    // summarized columns
+	std::vector<int> slot_of;  // for each column in the table, its place among the summarized ones or -1
+	std::vector<Zone> zones;   // zone of summarized column s in block b at [(b - 1) * columns.size() + s]
+	bool built;
+
+	int32_t summary(uint column, const Value &value) const;
+};